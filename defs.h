@@ -507,6 +507,7 @@ struct program_context {
 #define QEMU_MEM_DUMP (0x100ULL)
 #define GET_LOG       (0x200ULL)
 #define VMCOREINFO    (0x400ULL)
+#define MMAP_DUMPFILE (0x800ULL)
 	char *cleanup;
 	char *namelist_orig;
 	char *namelist_debug_orig;
@@ -2187,6 +2188,7 @@ struct vm_table {		/* kernel VM-related data */
 	int cpu_slab_type;
 	int nr_vm_event_items;
 	char **vm_event_items;
+	ulong vtop_extent;	/* contiguous bytes mapped by the last [ku]vtop() */
 };
 
 #define NODES                       (0x1)
@@ -2327,8 +2329,6 @@ struct rb_root {
 struct syment {
 	ulong value;
 	char *name;
-	struct syment *val_hash_next;
-	struct syment *name_hash_next;
 	char type;
 	unsigned char cnt;
 	unsigned char flags;
@@ -2348,14 +2348,6 @@ struct symbol_namespace {
 	long cnt;
 };
 
-#define SYMVAL_HASH (512)
-#define SYMVAL_HASH_INDEX(vaddr) \
-				(((vaddr) >> machdep->pageshift) % SYMVAL_HASH)
-
-#define SYMNAME_HASH (512)
-#define SYMNAME_HASH_INDEX(name) \
- ((name[0] ^ (name[strlen(name)-1] * name[strlen(name)/2])) % SYMNAME_HASH)
-
 #define PATCH_KERNEL_SYMBOLS_START  ((char *)(1))
 #define PATCH_KERNEL_SYMBOLS_STOP   ((char *)(2))
 
@@ -2373,13 +2365,15 @@ struct symbol_table_data {
 	struct syment *symend;
 	long symcnt;
 	ulong syment_size;
-	struct symval_hash_chain {
-		struct syment *val_hash_head;
-		struct syment *val_hash_last;
-	} symval_hash[SYMVAL_HASH];
-	double val_hash_searches;
-	double val_hash_iterations;
-	struct syment *symname_hash[SYMNAME_HASH];
+	ulong *symval;		/* symtable values, for binary searches */
+	double val_searches;
+	double val_iterations;
+	struct syment **symname_hash;	/* open-addressed, first of each name */
+	uint *symname_hashval;
+	ulong symname_hash_size;	/* power of 2 */
+	ulong symname_hash_cnt;
+	double name_searches;
+	double name_probes;
 	struct symbol_namespace kernel_namespace;
 	struct syment *ext_module_symtable;
 	struct syment *ext_module_symend;
@@ -3894,6 +3888,10 @@ struct gnu_request {
 	ulong task;
 	ulong debug;
 	struct stack_hook *hookp;
+	int member_bitsize;
+	int member_base_typecode;	/* with typedefs resolved */
+	int member_base_unsigned;
+	int member_target_typecode;	/* of a pointer member, typedefs resolved */
 };
 
 /*
@@ -4333,6 +4331,9 @@ int is_init_data(ulong value);
 int is_kernel_text_offset(ulong);
 int is_rodata(ulong, struct syment **);
 void datatype_init(void);
+void set_datatype_cache(char *);
+void datatype_cache_save(void);
+void dump_datatype_cache(FILE *);
 struct syment *symbol_search(char *);
 struct syment *value_search(ulong, ulong *);
 struct syment *value_search_base_kernel(ulong, ulong *);
@@ -4429,6 +4430,14 @@ void mem_init(void);
 void vm_init(void);
 int readmem(ulonglong, int, void *, long, char *, ulong);
 int writemem(ulonglong, int, void *, long, char *, ulong);
+int dump_page_cache_read(int, void *, int, ulong, physaddr_t);
+void dump_page_cache_flush(void);
+int dump_page_cache_present(physaddr_t);
+void vtop_cache_flush(void);
+void dump_vtop_cache(FILE *);
+void dump_page_cache_dump(FILE *);
+void set_dump_page_cache(char *);
+ulong get_dump_page_cache(void);
 int generic_verify_paddr(uint64_t);
 int read_dev_mem(int, void *, int, ulong, physaddr_t);
 int read_memory_device(int, void *, int, ulong, physaddr_t);
@@ -4521,6 +4530,11 @@ struct radix_tree_pair {
 	void *value;
 };
 ulong do_radix_tree(ulong, int, struct radix_tree_pair *);
+ulong radix_tree_walk(ulong, uint, int (*)(ulong, ulong, void *), void *);
+void radix_tree_init(void);
+extern ulong RADIX_TREE_MAP_SHIFT;
+extern ulong RADIX_TREE_MAP_SIZE;
+extern ulong RADIX_TREE_MAP_MASK;
 int file_dump(ulong, ulong, ulong, int, int);
 #define DUMP_FULL_NAME   1
 #define DUMP_INODE_ONLY  2
@@ -5319,6 +5333,8 @@ void s390x_dump_machdep_table(ulong);
 int is_netdump(char *, ulong);
 uint netdump_page_size(void);
 int read_netdump(int, void *, int, ulong, physaddr_t);
+long netdump_contiguous(physaddr_t, long);
+char *netdump_mmap_ptr(physaddr_t, long);
 int write_netdump(int, void *, int, ulong, physaddr_t);
 int netdump_free_memory(void);
 int netdump_memory_used(void);
@@ -5379,6 +5395,8 @@ FILE *set_diskdump_fp(FILE *);
 void get_diskdump_regs(struct bt_info *, ulong *, ulong *);
 int diskdump_phys_base(unsigned long *);
 ulong *diskdump_flags;
+void set_diskdump_threads(char *);
+int get_diskdump_threads(void);
 int is_partial_diskdump(void);
 int dumpfile_is_split(void);
 void show_split_dumpfiles(void);
@@ -5393,9 +5411,11 @@ void process_elf64_notes(void *, ulong);
  * makedumpfile.c
  */
 void check_flattened_format(char *file);
+void set_flat_index_dir(char *dir);
 int is_flattened_format(char *file);
 int read_flattened_format(int fd, off_t offset, void *buf, size_t size);
 void dump_flat_header(FILE *);
+int convert_flattened_format(char *, char *);
 
 /*
  * xendump.c
@@ -25,8 +25,10 @@
 
 #include "defs.h"
 #include "diskdump.h"
+#include <pthread.h>
+#include <semaphore.h>
 
-#define BITMAP_SECT_LEN	4096
+#define BITMAP_WORD_BITS	64
 
 struct diskdump_data {
 	char *filename;
@@ -48,23 +50,18 @@ struct diskdump_data {
 	char *dumpable_bitmap;
 	int byte, bit;
 	char *compressed_page;	/* copy of compressed page data */
-	char *curbufptr;	/* ptr to uncompressed page buffer */
+	char *page_buf;		/* uncompressed page, for partial page reads */
 	unsigned char *notes_buf;	/* copy of elf notes */
 	void **nt_prstatus_percpu;
 	uint num_prstatus_notes;
 
-	/* page cache */
-	struct page_cache_hdr {	/* header for each cached page */
-		uint32_t pg_flags;
-		uint64_t pg_addr;
-		char *pg_bufptr;
-		ulong pg_hit_count;
-	} page_cache_hdr[DISKDUMP_CACHED_PAGES];
-	char *page_cache_buf;	/* base of cached buffer pages */
-	int evict_index;	/* next page to evict */
-	ulong evictions;	/* total evictions done */
-	ulong cached_reads;
-	ulong *valid_pages;
+	ulong *valid_pages;	/* dumpable pages preceding each bitmap word */
+	ulong nr_words;		/* number of valid_pages entries, less one */
+	ulong first_pos;	/* dumpable pages preceding this file's start_pfn */
+	ulong nr_page_desc;	/* number of page descriptors in this file */
+	page_desc_t *page_desc;	/* mmap'd page descriptor table */
+	char *page_desc_map;	/* base of page_desc mapping */
+	size_t page_desc_map_len;
 	ulong accesses;
 };
 
@@ -198,6 +195,32 @@ static inline int page_is_dumpable(unsigned int nr)
 	return dd->dumpable_bitmap[nr >> 3] & (1 << (nr & 7));
 }
 
+/*
+ *  Return the 64 dumpable bits of bitmap word w, with pfn (w * 64) in
+ *  bit 0 regardless of host byte order.
+ */
+static inline ulonglong dumpable_word(ulong w)
+{
+	unsigned char *p = (unsigned char *)&dd->dumpable_bitmap[w * (BITMAP_WORD_BITS / 8)];
+
+	return (ulonglong) p[0] | (ulonglong) p[1] << 8 |
+	    (ulonglong) p[2] << 16 | (ulonglong) p[3] << 24 |
+	    (ulonglong) p[4] << 32 | (ulonglong) p[5] << 40 |
+	    (ulonglong) p[6] << 48 | (ulonglong) p[7] << 56;
+}
+
+/*
+ *  Return the number of dumpable pages from pfn 0 up to and including pfn.
+ */
+static inline ulong dumpable_rank(ulong pfn)
+{
+	ulong w = pfn / BITMAP_WORD_BITS;
+	int bit = pfn % BITMAP_WORD_BITS;
+	ulonglong mask = (bit == BITMAP_WORD_BITS - 1) ? ~0ULL : ((1ULL << (bit + 1)) - 1);
+
+	return dd->valid_pages[w] + __builtin_popcountll(dumpable_word(w) & mask);
+}
+
 static inline int dump_is_partial(const struct disk_dump_header *header)
 {
 	return header->bitmap_blocks >= divideup(divideup(header->max_mapnr, 8), dd->block_size) * 2;
@@ -373,8 +396,7 @@ static int read_dump_header(char *file)
 	int block_size = (int)sysconf(_SC_PAGESIZE);
 	off_t offset;
 	const off_t failed = (off_t) - 1;
-	ulong pfn;
-	int i, j, max_sect_len;
+	ulong w, start_pfn, end_pfn;
 	int is_split = 0;
 
 	if (block_size < 0)
@@ -628,23 +650,32 @@ static int read_dump_header(char *file)
 	}
 
 	if (!is_split) {
-		max_sect_len = divideup(header->max_mapnr, BITMAP_SECT_LEN);
-		pfn = 0;
+		start_pfn = 0;
+		end_pfn = header->max_mapnr - 1;
 		dd->filename = file;
 	} else {
-		ulong start = sub_header_kdump->start_pfn;
-		ulong end = sub_header_kdump->end_pfn;
-		max_sect_len = divideup(end - start + 1, BITMAP_SECT_LEN);
-		pfn = start;
+		start_pfn = sub_header_kdump->start_pfn;
+		end_pfn = sub_header_kdump->end_pfn;
 	}
 
-	dd->valid_pages = calloc(sizeof(ulong), max_sect_len + 1);
-	for (i = 1; i < max_sect_len + 1; i++) {
-		dd->valid_pages[i] = dd->valid_pages[i - 1];
-		for (j = 0; j < BITMAP_SECT_LEN; j++, pfn++)
-			if (page_is_dumpable(pfn))
-				dd->valid_pages[i]++;
-	}
+	/*
+	 *  Build the rank index of the dumpable bitmap: for each 64-bit word,
+	 *  the number of dumpable pages in all of the words that precede it.
+	 *  The page descriptor of a pfn is then found with one popcount.
+	 */
+	dd->nr_words = bitmap_len / (BITMAP_WORD_BITS / 8);
+	if ((dd->valid_pages = malloc((dd->nr_words + 1) * sizeof(ulong))) == NULL)
+		error(FATAL, "%s: cannot malloc dumpable page index\n",
+		      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
+
+	dd->valid_pages[0] = 0;
+	for (w = 0; w < dd->nr_words; w++)
+		dd->valid_pages[w + 1] = dd->valid_pages[w] +
+		    __builtin_popcountll(dumpable_word(w));
+
+	dd->first_pos = start_pfn ? dumpable_rank(start_pfn - 1) : 0;
+	dd->nr_page_desc = dumpable_rank(MIN(end_pfn, dd->nr_words * BITMAP_WORD_BITS - 1))
+	    - dd->first_pos;
 
 	return TRUE;
 
@@ -668,26 +699,53 @@ static int read_dump_header(char *file)
 	return FALSE;
 }
 
+/*
+ *  Return the 1-based position of the pfn's page descriptor in this
+ *  dumpfile's page descriptor table.
+ */
 static ulong pfn_to_pos(ulong pfn)
 {
-	ulong desc_pos, j, valid;
-	ulong p1, p2;
+	return dumpable_rank(pfn) - dd->first_pos;
+}
 
-	if (KDUMP_SPLIT()) {
-		p1 = pfn - dd->sub_header_kdump->start_pfn;
-		p2 = round(p1, BITMAP_SECT_LEN) + dd->sub_header_kdump->start_pfn;
-	} else {
-		p1 = pfn;
-		p2 = round(pfn, BITMAP_SECT_LEN);
-	}
+/*
+ *  Map the page descriptor table so that read_page() can look up a
+ *  descriptor without a system call.  This is not possible for flattened
+ *  format dumpfiles, or if the table would extend past the end of a
+ *  truncated dumpfile; in those cases the descriptors are read one at
+ *  a time.
+ */
+static void map_page_desc_table(void)
+{
+	struct stat st;
+	off_t map_offset;
+	size_t len;
+	char *map;
 
-	valid = dd->valid_pages[p1 / BITMAP_SECT_LEN];
+	if (FLAT_FORMAT() || !dd->nr_page_desc)
+		return;
 
-	for (j = p2, desc_pos = valid; j <= pfn; j++)
-		if (page_is_dumpable(j))
-			desc_pos++;
+	map_offset = dd->data_offset & ~((off_t)sysconf(_SC_PAGESIZE) - 1);
+	len = (dd->data_offset - map_offset) + dd->nr_page_desc * sizeof(page_desc_t);
 
-	return desc_pos;
+	if ((fstat(dd->dfd, &st) < 0) || (st.st_size < (map_offset + len))) {
+		if (CRASHDEBUG(1))
+			error(INFO, "%s: page descriptor table is truncated\n",
+			      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
+		return;
+	}
+
+	map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, dd->dfd, map_offset);
+	if (map == MAP_FAILED) {
+		if (CRASHDEBUG(1))
+			error(INFO, "%s: cannot mmap page descriptor table: %s\n",
+			      DISKDUMP_VALID()? "diskdump" : "compressed kdump", strerror(errno));
+		return;
+	}
+
+	dd->page_desc_map = map;
+	dd->page_desc_map_len = len;
+	dd->page_desc = (page_desc_t *)(map + (dd->data_offset - map_offset));
 }
 
 /*
@@ -697,23 +755,19 @@ static ulong pfn_to_pos(ulong pfn)
  */
 int is_diskdump(char *file)
 {
-	int sz, i;
-
 	if (!open_dump_file(file) || !read_dump_header(file))
 		return FALSE;
 
-	sz = dd->block_size * (DISKDUMP_CACHED_PAGES);
-	if ((dd->page_cache_buf = malloc(sz)) == NULL)
-		error(FATAL, "%s: cannot malloc compressed page_cache_buf\n",
-		      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
-
-	for (i = 0; i < DISKDUMP_CACHED_PAGES; i++)
-		dd->page_cache_hdr[i].pg_bufptr = &dd->page_cache_buf[i * dd->block_size];
+	map_page_desc_table();
 
 	if ((dd->compressed_page = (char *)malloc(dd->block_size)) == NULL)
 		error(FATAL, "%s: cannot malloc compressed page space\n",
 		      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
 
+	if ((dd->page_buf = (char *)malloc(dd->block_size)) == NULL)
+		error(FATAL, "%s: cannot malloc uncompressed page space\n",
+		      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
+
 	if (CRASHDEBUG(1))
 		__diskdump_memory_dump(fp);
 
@@ -765,33 +819,6 @@ int diskdump_phys_base(unsigned long *phys_base)
 	return FALSE;
 }
 
-/*
- *  Check whether paddr is already cached.
- */
-static int page_is_cached(physaddr_t paddr)
-{
-	int i;
-	struct page_cache_hdr *pgc;
-
-	dd->accesses++;
-
-	for (i = 0; i < DISKDUMP_CACHED_PAGES; i++) {
-
-		pgc = &dd->page_cache_hdr[i];
-
-		if (!DISKDUMP_VALID_PAGE(pgc->pg_flags))
-			continue;
-
-		if (pgc->pg_addr == paddr) {
-			pgc->pg_hit_count++;
-			dd->curbufptr = pgc->pg_bufptr;
-			dd->cached_reads++;
-			return TRUE;
-		}
-	}
-	return FALSE;
-}
-
 /*
  * Translate physical address in paddr to PFN number. This means normally that
  * we just shift paddr by some constant. Some architectures need special
@@ -811,138 +838,460 @@ static ulong paddr_to_pfn(physaddr_t paddr)
 }
 
 /*
- *  Cache the page's data.
- *
- *  If an empty page cache location is available, take it.  Otherwise, evict
- *  the entry indexed by evict_index, and then bump evict index.  The hit_count
- *  is only gathered for dump_diskdump_environment().
- *
- *  If the page is compressed, uncompress it into the selected page cache entry.
- *  If the page is raw, just copy it into the selected page cache entry.
- *  If all works OK, update diskdump->curbufptr to point to the page's
- *  uncompressed data.
+ *  Uncompress (or copy) a page's data from src into the block_size buffer
+ *  at dst, based upon the flags in its page descriptor.  This is also
+ *  called by the readahead threads, which pass verbose as FALSE so that
+ *  a failure is left to be reported when the page is read synchronously.
  */
-static int cache_page(physaddr_t paddr)
+static int uncompress_page(struct diskdump_data *ddp, page_desc_t *pd, char *src, char *dst, int verbose)
+{
+	int ret;
+	ulong retlen;
+	const int block_size = ddp->block_size;
+
+	if (pd->flags & DUMP_DH_COMPRESSED_ZLIB) {
+		retlen = block_size;
+		ret = uncompress((unsigned char *)dst, &retlen, (unsigned char *)src, pd->size);
+		if ((ret != Z_OK) || (retlen != block_size)) {
+			if (verbose)
+				error(INFO, "%s: uncompress failed: %d\n",
+				      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
+			return READ_ERROR;
+		}
+	} else if (pd->flags & DUMP_DH_COMPRESSED_LZO) {
+
+		if (!(ddp->flags & LZO_SUPPORTED)) {
+			if (verbose)
+				error(INFO,
+				      "%s: uncompress failed: no lzo compression support\n",
+				      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
+			return READ_ERROR;
+		}
+#ifdef LZO
+		retlen = block_size;
+		ret = lzo1x_decompress_safe((unsigned char *)src, pd->size,
+					    (unsigned char *)dst, &retlen, LZO1X_MEM_DECOMPRESS);
+		if ((ret != LZO_E_OK) || (retlen != block_size)) {
+			if (verbose)
+				error(INFO, "%s: uncompress failed: %d\n",
+				      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
+			return READ_ERROR;
+		}
+#endif
+	} else if (pd->flags & DUMP_DH_COMPRESSED_SNAPPY) {
+
+		if (!(ddp->flags & SNAPPY_SUPPORTED)) {
+			if (verbose)
+				error(INFO,
+				      "%s: uncompress failed: no snappy compression support\n",
+				      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
+			return READ_ERROR;
+		}
+#ifdef SNAPPY
+		ret = snappy_uncompressed_length(src, pd->size, &retlen);
+		if (ret != SNAPPY_OK) {
+			if (verbose)
+				error(INFO, "%s: uncompress failed: %d\n",
+				      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
+			return READ_ERROR;
+		}
+
+		ret = snappy_uncompress(src, pd->size, dst, &retlen);
+		if ((ret != SNAPPY_OK) || (retlen != block_size)) {
+			if (verbose)
+				error(INFO, "%s: uncompress failed: %d\n",
+				      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
+			return READ_ERROR;
+		}
+#endif
+	} else
+		memcpy(dst, src, block_size);
+
+	return TRUE;
+}
+
+/*
+ *  Find the page descriptor of a dumpable pfn.  If nosys is set, only
+ *  the mmap'd descriptor table may be used.
+ */
+static int read_page_desc(ulong pfn, page_desc_t *pd, int nosys)
 {
-	int i, ret;
-	int found;
-	ulong pfn;
 	ulong desc_pos;
 	off_t seek_offset;
-	page_desc_t pd;
-	const int block_size = dd->block_size;
 	const off_t failed = (off_t) - 1;
-	ulong retlen;
 
-	for (i = found = 0; i < DISKDUMP_CACHED_PAGES; i++) {
-		if (DISKDUMP_VALID_PAGE(dd->page_cache_hdr[i].pg_flags))
-			continue;
-		found = TRUE;
-		break;
-	}
+	desc_pos = pfn_to_pos(pfn);
 
-	if (!found) {
-		i = dd->evict_index;
-		dd->page_cache_hdr[i].pg_hit_count = 0;
-		dd->evict_index = (dd->evict_index + 1) % DISKDUMP_CACHED_PAGES;
-		dd->evictions++;
+	if (dd->page_desc && (desc_pos <= dd->nr_page_desc)) {
+		BCOPY(&dd->page_desc[desc_pos - 1], pd, sizeof(page_desc_t));
+		return TRUE;
 	}
 
-	dd->page_cache_hdr[i].pg_flags = 0;
-	dd->page_cache_hdr[i].pg_addr = paddr;
-	dd->page_cache_hdr[i].pg_hit_count++;
+	if (nosys)
+		return READ_ERROR;
 
-	/* find page descriptor */
-	pfn = paddr_to_pfn(paddr);
-	desc_pos = pfn_to_pos(pfn);
 	seek_offset = dd->data_offset + (off_t) (desc_pos - 1) * sizeof(page_desc_t);
 
-	/* read page descriptor */
 	if (FLAT_FORMAT()) {
-		if (!read_flattened_format(dd->dfd, seek_offset, &pd, sizeof(pd)))
+		if (!read_flattened_format(dd->dfd, seek_offset, pd, sizeof(page_desc_t)))
 			return READ_ERROR;
 	} else {
 		if (lseek(dd->dfd, seek_offset, SEEK_SET) == failed)
 			return SEEK_ERROR;
-		if (read(dd->dfd, &pd, sizeof(pd)) != sizeof(pd))
+		if (read(dd->dfd, pd, sizeof(page_desc_t)) != sizeof(page_desc_t))
 			return READ_ERROR;
 	}
 
-	/* sanity check */
-	if (pd.size > block_size)
-		return READ_ERROR;
+	return TRUE;
+}
 
-	/* read page data */
-	if (FLAT_FORMAT()) {
-		if (!read_flattened_format(dd->dfd, pd.offset, dd->compressed_page, pd.size))
-			return READ_ERROR;
-	} else {
-		if (lseek(dd->dfd, pd.offset, SEEK_SET) == failed)
-			return SEEK_ERROR;
-		if (read(dd->dfd, dd->compressed_page, pd.size) != pd.size)
-			return READ_ERROR;
+/*
+ *  Readahead of compressed pages.
+ *
+ *  When read_page() sees three or more reads whose pfns are separated
+ *  by the same small forward stride, the descriptors of the next pages in
+ *  the sequence are queued in the readahead slots, where a pool of worker
+ *  threads pread() and uncompress them in the background.  A later read
+ *  of one of those pages copies the uncompressed data out of its slot.
+ *
+ *  The command thread never blocks on a lock, since a signal may longjmp
+ *  out of any readmem() call: each slot's state is changed with atomic
+ *  compare-and-swap operations, and only the command thread fills in a
+ *  FREE or DONE slot.  The workers block all signals, never call error(),
+ *  and only use the read-only fields of the diskdump_data structure.
+ *  Readahead requires the mmap'd page descriptor table, and is therefore
+ *  not done for flattened format dumpfiles.
+ */
+#define RA_FREE		0
+#define RA_QUEUED	1
+#define RA_BUSY		2
+#define RA_DONE		3
+
+#define RA_SLOT(pfn)	(((pfn) ^ ((pfn) >> 8)) & (DISKDUMP_READAHEAD_SLOTS - 1))
+
+struct readahead_slot {
+	volatile int state;
+	int error;
+	struct diskdump_data *ddp;
+	physaddr_t paddr;
+	page_desc_t pd;
+	char *buf;		/* uncompressed page */
+};
+
+static struct diskdump_readahead {
+	int max_threads;	/* --dump_threads or "set dump_threads" value */
+	int threads;		/* worker threads started */
+	int block_size;
+	struct readahead_slot *slots;
+	sem_t work;		/* posted once per queued slot */
+	ulong last_pfn;
+	long stride;
+	int run;		/* consecutive misses at stride */
+	ulong next_pfn;		/* next pfn to be queued */
+	ulong issued;
+	ulong used;
+	ulong cancelled;
+	ulong waits;
+} diskdump_readahead = { .max_threads = -1 };
+
+static struct diskdump_readahead *ra = &diskdump_readahead;
+
+static void *readahead_worker(void *arg)
+{
+	int i;
+	char *cbuf = arg;
+	struct readahead_slot *slot;
+
+	for (;;) {
+		if (sem_wait(&ra->work) < 0)
+			continue;
+
+		for (i = 0; i < DISKDUMP_READAHEAD_SLOTS; i++) {
+			slot = &ra->slots[i];
+			if ((slot->state == RA_QUEUED) &&
+			    __sync_bool_compare_and_swap(&slot->state, RA_QUEUED, RA_BUSY))
+				break;
+		}
+		if (i == DISKDUMP_READAHEAD_SLOTS)
+			continue;	/* cancelled */
+
+		slot->error = (pread(slot->ddp->dfd, cbuf, slot->pd.size, slot->pd.offset) != slot->pd.size) ||
+		    (uncompress_page(slot->ddp, &slot->pd, cbuf, slot->buf, FALSE) < 0);
+
+		__sync_synchronize();
+		slot->state = RA_DONE;
 	}
 
-	if (pd.flags & DUMP_DH_COMPRESSED_ZLIB) {
-		retlen = block_size;
-		ret =
-		    uncompress((unsigned char *)dd->page_cache_hdr[i].pg_bufptr,
-			       &retlen, (unsigned char *)dd->compressed_page, pd.size);
-		if ((ret != Z_OK) || (retlen != block_size)) {
-			error(INFO, "%s: uncompress failed: %d\n",
-			      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
-			return READ_ERROR;
+	return NULL;
+}
+
+/*
+ *  Start worker threads up to the configured maximum, allocating the
+ *  readahead slots the first time through.
+ */
+static void readahead_start(void)
+{
+	int i;
+	char *cbuf;
+	pthread_t thread;
+	pthread_attr_t attr;
+	sigset_t all, old;
+
+	if (!ra->slots) {
+		if ((ra->slots = calloc(DISKDUMP_READAHEAD_SLOTS, sizeof(struct readahead_slot))) == NULL)
+			goto fail;
+		for (i = 0; i < DISKDUMP_READAHEAD_SLOTS; i++) {
+			if ((ra->slots[i].buf = malloc(dd->block_size)) == NULL)
+				goto fail;
 		}
-	} else if (pd.flags & DUMP_DH_COMPRESSED_LZO) {
+		if (sem_init(&ra->work, 0, 0) < 0)
+			goto fail;
+		ra->block_size = dd->block_size;
+	}
 
-		if (!(dd->flags & LZO_SUPPORTED)) {
-			error(INFO,
-			      "%s: uncompress failed: no lzo compression support\n",
-			      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
-			return READ_ERROR;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+
+	while (ra->threads < ra->max_threads) {
+		if ((cbuf = malloc(ra->block_size)) == NULL)
+			break;
+		if (pthread_create(&thread, &attr, readahead_worker, cbuf)) {
+			free(cbuf);
+			break;
 		}
-#ifdef LZO
-		retlen = block_size;
-		ret =
-		    lzo1x_decompress_safe((unsigned char *)dd->compressed_page,
-					  pd.size,
-					  (unsigned char *)dd->page_cache_hdr[i].pg_bufptr, &retlen,
-					  LZO1X_MEM_DECOMPRESS);
-		if ((ret != LZO_E_OK) || (retlen != block_size)) {
-			error(INFO, "%s: uncompress failed: %d\n",
-			      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
-			return READ_ERROR;
+		ra->threads++;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	pthread_attr_destroy(&attr);
+
+	if (CRASHDEBUG(1))
+		error(INFO, "%s: %d readahead thread%s\n",
+		      DISKDUMP_VALID()? "diskdump" : "compressed kdump",
+		      ra->threads, ra->threads == 1 ? "" : "s");
+	return;
+
+ fail:
+	error(INFO, "%s: cannot allocate readahead slots: readahead disabled\n",
+	      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
+	ra->max_threads = 0;
+}
+
+/*
+ *  Copy a page that has been read ahead into buf.  A queued request for
+ *  the page is cancelled, and one that is being worked on is waited for.
+ */
+static int readahead_lookup(physaddr_t paddr, char *buf)
+{
+	int ok;
+	struct readahead_slot *slot;
+
+	if (!ra->slots)
+		return FALSE;
+
+	slot = &ra->slots[RA_SLOT(paddr_to_pfn(paddr))];
+
+	for (;;) {
+		if ((slot->ddp != dd) || (slot->paddr != paddr))
+			return FALSE;
+
+		switch (slot->state)
+		{
+		case RA_FREE:
+			return FALSE;
+
+		case RA_QUEUED:
+			if (__sync_bool_compare_and_swap(&slot->state, RA_QUEUED, RA_FREE)) {
+				ra->cancelled++;
+				return FALSE;
+			}
+			break;
+
+		case RA_BUSY:
+			ra->waits++;
+			sched_yield();
+			break;
+
+		case RA_DONE:
+			__sync_synchronize();
+			if ((ok = !slot->error)) {
+				memcpy(buf, slot->buf, dd->block_size);
+				ra->used++;
+			}
+			slot->state = RA_FREE;
+			return ok;
 		}
+	}
+}
+
+/*
+ *  Queue a dumpable page for readahead if its slot is available.
+ */
+static void readahead_queue(ulong pfn)
+{
+	physaddr_t paddr;
+	page_desc_t pd;
+	struct readahead_slot *slot;
+
+	slot = &ra->slots[RA_SLOT(pfn)];
+	paddr = (physaddr_t)pfn << dd->block_shift;
+#ifdef ARM
+	paddr += machdep->machspec->phys_base;
 #endif
-	} else if (pd.flags & DUMP_DH_COMPRESSED_SNAPPY) {
+	switch (slot->state)
+	{
+	case RA_BUSY:
+		return;
+	case RA_QUEUED:
+		if ((slot->ddp == dd) && (slot->paddr == paddr))
+			return;
+		if (!__sync_bool_compare_and_swap(&slot->state, RA_QUEUED, RA_FREE))
+			return;
+		ra->cancelled++;
+		break;
+	case RA_DONE:
+		if ((slot->ddp == dd) && (slot->paddr == paddr))
+			return;
+		break;
+	}
 
-		if (!(dd->flags & SNAPPY_SUPPORTED)) {
-			error(INFO,
-			      "%s: uncompress failed: no snappy compression support\n",
-			      DISKDUMP_VALID()? "diskdump" : "compressed kdump");
-			return READ_ERROR;
-		}
-#ifdef SNAPPY
-		ret = snappy_uncompressed_length((char *)dd->compressed_page, pd.size, &retlen);
-		if (ret != SNAPPY_OK) {
-			error(INFO, "%s: uncompress failed: %d\n",
-			      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
-			return READ_ERROR;
-		}
+	if (dump_page_cache_present(paddr))
+		return;
 
-		ret = snappy_uncompress((char *)dd->compressed_page, pd.size,
-					(char *)dd->page_cache_hdr[i].pg_bufptr, &retlen);
-		if ((ret != SNAPPY_OK) || (retlen != block_size)) {
-			error(INFO, "%s: uncompress failed: %d\n",
-			      DISKDUMP_VALID()? "diskdump" : "compressed kdump", ret);
+	if ((read_page_desc(pfn, &pd, TRUE) < 0) || (pd.size > dd->block_size))
+		return;
+
+	slot->ddp = dd;
+	slot->paddr = paddr;
+	slot->pd = pd;
+	slot->error = 0;
+	__sync_synchronize();
+	slot->state = RA_QUEUED;
+	sem_post(&ra->work);
+	ra->issued++;
+}
+
+/*
+ *  Called for each page read from the dumpfile to detect a forward
+ *  sequential or strided scan, and to keep the readahead window ahead of it.
+ */
+static void readahead_check(ulong pfn)
+{
+	long stride;
+	ulong end, limit;
+
+	if (!ra->max_threads || !dd->page_desc || (dd->block_size != ra->block_size && ra->slots))
+		return;
+
+	stride = pfn - ra->last_pfn;
+	ra->last_pfn = pfn;
+
+	/*
+	 *  Non-dumpable pages never get here, so a scan at the current
+	 *  stride may skip over a few of them.
+	 */
+	if ((ra->stride > 0) && (stride > 0) && (stride % ra->stride == 0) &&
+	    (stride <= ra->stride * DISKDUMP_READAHEAD_STRIDE))
+		stride = ra->stride;
+
+	if ((stride <= 0) || (stride > DISKDUMP_READAHEAD_STRIDE) || (stride != ra->stride)) {
+		ra->stride = stride;
+		ra->run = 1;
+		ra->next_pfn = 0;
+		return;
+	}
+
+	if (++ra->run < 3)
+		return;
+
+	if (!ra->threads) {
+		if (ra->max_threads < 0)
+			ra->max_threads = MIN(MAX(sysconf(_SC_NPROCESSORS_ONLN) - 1, 0), DISKDUMP_READAHEAD_THREADS);
+		readahead_start();
+		if (!ra->threads)
+			return;
+	}
+
+	limit = KDUMP_SPLIT() ? dd->sub_header_kdump->end_pfn + 1 : dd->header->max_mapnr;
+	end = MIN(pfn + stride * DISKDUMP_READAHEAD_PAGES, limit);
+
+	if (ra->next_pfn <= pfn)
+		ra->next_pfn = pfn + stride;
+
+	for ( ; ra->next_pfn < end; ra->next_pfn += stride) {
+		if (page_is_ram(ra->next_pfn) && page_is_dumpable(ra->next_pfn))
+			readahead_queue(ra->next_pfn);
+	}
+}
+
+/*
+ *  Set the number of readahead threads from the --dump_threads command
+ *  line option or by "set dump_threads".  Zero disables readahead.
+ */
+void set_diskdump_threads(char *arg)
+{
+	long threads;
+
+	if (!decimal(arg, 0) || ((threads = dtol(arg, RETURN_ON_ERROR, NULL)) < 0))
+		error(FATAL, "invalid dump_threads value: %s\n", arg);
+
+	ra->max_threads = MIN(threads, DISKDUMP_READAHEAD_MAX_THREADS);
+	if (ra->threads && (ra->threads < ra->max_threads))
+		readahead_start();
+}
+
+int get_diskdump_threads(void)
+{
+	if (ra->max_threads < 0)
+		return MIN(MAX(sysconf(_SC_NPROCESSORS_ONLN) - 1, 0), DISKDUMP_READAHEAD_THREADS);
+	return ra->max_threads;
+}
+
+/*
+ *  Read a page's data into buf, which must hold a whole block.
+ *
+ *  If the page has already been read ahead, copy it from its readahead slot.
+ *  Otherwise, if the page is compressed, uncompress it into buf, and if it
+ *  is raw, just copy it.  Pages are not cached here: read_diskdump() is the
+ *  fill function of the generic dump page cache in memory.c.
+ */
+static int read_page(physaddr_t paddr, char *buf)
+{
+	int ret;
+	ulong pfn;
+	page_desc_t pd;
+	const int block_size = dd->block_size;
+	const off_t failed = (off_t) - 1;
+
+	pfn = paddr_to_pfn(paddr);
+
+	if (!readahead_lookup(paddr, buf)) {
+		/* find page descriptor */
+		if ((ret = read_page_desc(pfn, &pd, FALSE)) < 0)
+			return ret;
+
+		/* sanity check */
+		if (pd.size > block_size)
 			return READ_ERROR;
+
+		/* read page data */
+		if (FLAT_FORMAT()) {
+			if (!read_flattened_format(dd->dfd, pd.offset, dd->compressed_page, pd.size))
+				return READ_ERROR;
+		} else {
+			if (lseek(dd->dfd, pd.offset, SEEK_SET) == failed)
+				return SEEK_ERROR;
+			if (read(dd->dfd, dd->compressed_page, pd.size) != pd.size)
+				return READ_ERROR;
 		}
-#endif
-	} else
-		memcpy(dd->page_cache_hdr[i].pg_bufptr, dd->compressed_page, block_size);
 
-	dd->page_cache_hdr[i].pg_flags |= PAGE_VALID;
-	dd->curbufptr = dd->page_cache_hdr[i].pg_bufptr;
+		if ((ret = uncompress_page(dd, &pd, dd->compressed_page, buf, TRUE)) < 0)
+			return ret;
+	}
+
+	readahead_check(pfn);
 
 	return TRUE;
 }
@@ -952,7 +1301,7 @@ static int cache_page(physaddr_t paddr)
  */
 int read_diskdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 {
-	int ret;
+	int ret, whole;
 	physaddr_t curpaddr;
 	ulong pfn, page_offset;
 
@@ -1009,23 +1358,23 @@ int read_diskdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 		return cnt;
 	}
 
-	if (!page_is_cached(curpaddr)) {
-		if (CRASHDEBUG(8))
-			fprintf(fp, "read_diskdump: paddr/pfn: %llx/%lx"
-				" -> cache physical page: %llx\n", (ulonglong) paddr, pfn, (ulonglong) curpaddr);
+	dd->accesses++;
+	whole = (page_offset == 0) && (cnt == dd->block_size);
 
-		if ((ret = cache_page(curpaddr)) < 0) {
-			if (CRASHDEBUG(8))
-				fprintf(fp, "read_diskdump: "
-					"%s: cannot cache page: %llx\n",
-					ret == SEEK_ERROR ? "SEEK_ERROR" : "READ_ERROR", (ulonglong) curpaddr);
-			return ret;
-		}
-	} else if (CRASHDEBUG(8))
+	if (CRASHDEBUG(8))
 		fprintf(fp, "read_diskdump: paddr/pfn: %llx/%lx"
-			" -> physical page is cached: %llx\n", (ulonglong) paddr, pfn, (ulonglong) curpaddr);
+			" -> read physical page: %llx\n", (ulonglong) paddr, pfn, (ulonglong) curpaddr);
+
+	if ((ret = read_page(curpaddr, whole ? bufptr : dd->page_buf)) < 0) {
+		if (CRASHDEBUG(8))
+			fprintf(fp, "read_diskdump: "
+				"%s: cannot read page: %llx\n",
+				ret == SEEK_ERROR ? "SEEK_ERROR" : "READ_ERROR", (ulonglong) curpaddr);
+		return ret;
+	}
 
-	memcpy(bufptr, dd->curbufptr + page_offset, cnt);
+	if (!whole)
+		memcpy(bufptr, dd->page_buf + page_offset, cnt);
 	return cnt;
 }
 
@@ -1545,30 +1894,23 @@ int __diskdump_memory_dump(FILE * fp)
 	fprintf(fp, "              byte: %d\n", dd->byte);
 	fprintf(fp, "               bit: %d\n", dd->bit);
 	fprintf(fp, "   compressed_page: %lx\n", (ulong) dd->compressed_page);
-	fprintf(fp, "         curbufptr: %lx\n\n", (ulong) dd->curbufptr);
-
-	for (i = 0; i < DISKDUMP_CACHED_PAGES; i++) {
-		fprintf(fp, "%spage_cache_hdr[%d]:\n", i < 10 ? " " : "", i);
-		fprintf(fp, "            pg_flags: %x (", dd->page_cache_hdr[i].pg_flags);
-		others = 0;
-		if (dd->page_cache_hdr[i].pg_flags & PAGE_VALID)
-			fprintf(fp, "%sPAGE_VALID", others++ ? "|" : "");
-		fprintf(fp, ")\n");
-		fprintf(fp, "             pg_addr: %llx\n", (ulonglong) dd->page_cache_hdr[i].pg_addr);
-		fprintf(fp, "           pg_bufptr: %lx\n", (ulong) dd->page_cache_hdr[i].pg_bufptr);
-		fprintf(fp, "        pg_hit_count: %ld\n", dd->page_cache_hdr[i].pg_hit_count);
-	}
+	fprintf(fp, "          page_buf: %lx\n\n", (ulong) dd->page_buf);
 
-	fprintf(fp, "\n    page_cache_buf: %lx\n", (ulong) dd->page_cache_buf);
-	fprintf(fp, "       evict_index: %d\n", dd->evict_index);
-	fprintf(fp, "         evictions: %ld\n", dd->evictions);
 	fprintf(fp, "          accesses: %ld\n", dd->accesses);
-	fprintf(fp, "      cached_reads: %ld ", dd->cached_reads);
-	if (dd->accesses)
-		fprintf(fp, "(%ld%%)\n", dd->cached_reads * 100 / dd->accesses);
-	else
-		fprintf(fp, "\n");
+	fprintf(fp, "         readahead: %d thread%s (max: %d)\n", ra->threads,
+		ra->threads == 1 ? "" : "s", get_diskdump_threads());
+	fprintf(fp, "         ra_stride: %ld (run: %d)\n", ra->stride, ra->run);
+	fprintf(fp, "         ra_issued: %ld\n", ra->issued);
+	fprintf(fp, "           ra_used: %ld\n", ra->used);
+	fprintf(fp, "      ra_cancelled: %ld\n", ra->cancelled);
+	fprintf(fp, "          ra_waits: %ld\n", ra->waits);
 	fprintf(fp, "       valid_pages: %lx\n", (ulong) dd->valid_pages);
+	fprintf(fp, "          nr_words: %ld\n", dd->nr_words);
+	fprintf(fp, "         first_pos: %ld\n", dd->first_pos);
+	fprintf(fp, "      nr_page_desc: %ld\n", dd->nr_page_desc);
+	fprintf(fp, "         page_desc: %lx\n", (ulong) dd->page_desc);
+	fprintf(fp, "     page_desc_map: %lx (%ld bytes)\n", (ulong) dd->page_desc_map,
+		(ulong) dd->page_desc_map_len);
 
 	return 0;
 }
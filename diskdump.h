@@ -84,6 +84,8 @@ typedef struct page_desc {
 	unsigned long long page_flags;	/* page flags */
 } page_desc_t;
 
-#define DISKDUMP_CACHED_PAGES	(16)
-#define PAGE_VALID		(0x1)	/* flags */
-#define DISKDUMP_VALID_PAGE(flags)	((flags) & PAGE_VALID)
+#define DISKDUMP_READAHEAD_SLOTS	(256)	/* must be a power of 2 */
+#define DISKDUMP_READAHEAD_PAGES	(64)	/* readahead window */
+#define DISKDUMP_READAHEAD_STRIDE	(16)	/* largest pfn stride detected */
+#define DISKDUMP_READAHEAD_THREADS	(8)	/* default maximum */
+#define DISKDUMP_READAHEAD_MAX_THREADS	(64)
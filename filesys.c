@@ -45,6 +45,10 @@ static int get_memory_driver_dev(dev_t *);
 static int memory_driver_init(void);
 static int create_memory_device(dev_t);
 static void *radix_tree_lookup(ulong, ulong, int);
+static ulong radix_tree_rnode(ulong);
+static int radix_tree_walk_node(ulong, uint, ulong, ulong *, int (*)(ulong, ulong, void *), void *, ulong *);
+static int radix_tree_dump_entry(ulong, ulong, void *);
+static int radix_tree_gather_entry(ulong, ulong, void *);
 static int match_file_string(char *, char *, char *);
 static ulong get_root_vfsmount(char *);
 
@@ -3451,6 +3455,30 @@ ulong RADIX_TREE_MAP_SHIFT = UNINITIALIZED;
 ulong RADIX_TREE_MAP_SIZE = UNINITIALIZED;
 ulong RADIX_TREE_MAP_MASK = UNINITIALIZED;
 
+/*
+ *  Size the radix_tree_node.slots[] array, shared by do_radix_tree(),
+ *  do_rdtree() and radix_tree_walk().
+ */
+void radix_tree_init(void)
+{
+	long nlen;
+
+	if (RADIX_TREE_MAP_SHIFT != UNINITIALIZED)
+		return;
+
+	if (!(nlen = MEMBER_SIZE("radix_tree_node", "slots")))
+		error(FATAL, "cannot determine length of " "radix_tree_node.slots[] array\n");
+	nlen /= sizeof(void *);
+	RADIX_TREE_MAP_SHIFT = ffsl(nlen) - 1;
+	RADIX_TREE_MAP_SIZE = (1UL << RADIX_TREE_MAP_SHIFT);
+	RADIX_TREE_MAP_MASK = (RADIX_TREE_MAP_SIZE - 1);
+}
+
+struct radix_tree_gather {
+	struct radix_tree_pair *rtp;	/* next pair to fill in */
+	ulong maxcount;			/* remaining, or 0 for no limit */
+};
+
 /*
  *  do_radix_tree argument usage:
  *
@@ -3478,11 +3506,10 @@ ulong RADIX_TREE_MAP_MASK = UNINITIALIZED;
 ulong do_radix_tree(ulong root, int flag, struct radix_tree_pair * rtp)
 {
 	int i, ilen, height;
-	long nlen;
-	ulong index, maxindex, count, maxcount;
+	ulong maxindex, count;
 	long *height_to_maxindex;
 	char *radix_tree_root_buf;
-	struct radix_tree_pair *r;
+	struct radix_tree_gather gather;
 	ulong root_rnode;
 	void *ret;
 
@@ -3494,14 +3521,7 @@ ulong do_radix_tree(ulong root, int flag, struct radix_tree_pair * rtp)
 	    !VALID_MEMBER(radix_tree_node_slots) || !ARRAY_LENGTH(height_to_maxindex))
 		error(FATAL, "radix trees do not exist (or have changed their format)\n");
 
-	if (RADIX_TREE_MAP_SHIFT == UNINITIALIZED) {
-		if (!(nlen = MEMBER_SIZE("radix_tree_node", "slots")))
-			error(FATAL, "cannot determine length of " "radix_tree_node.slots[] array\n");
-		nlen /= sizeof(void *);
-		RADIX_TREE_MAP_SHIFT = ffsl(nlen) - 1;
-		RADIX_TREE_MAP_SIZE = (1UL << RADIX_TREE_MAP_SHIFT);
-		RADIX_TREE_MAP_MASK = (RADIX_TREE_MAP_SIZE - 1);
-	}
+	radix_tree_init();
 
 	ilen = ARRAY_LENGTH(height_to_maxindex);
 	height_to_maxindex = (long *)GETBUF(ilen * sizeof(long));
@@ -3536,10 +3556,7 @@ ulong do_radix_tree(ulong root, int flag, struct radix_tree_pair * rtp)
 
 	switch (flag) {
 	case RADIX_TREE_COUNT:
-		for (index = count = 0; index <= maxindex; index++) {
-			if (radix_tree_lookup(root_rnode, index, height))
-				count++;
-		}
+		count = radix_tree_walk(radix_tree_rnode(root_rnode), height, NULL, NULL);
 		break;
 
 	case RADIX_TREE_SEARCH:
@@ -3554,28 +3571,15 @@ ulong do_radix_tree(ulong root, int flag, struct radix_tree_pair * rtp)
 		break;
 
 	case RADIX_TREE_DUMP:
-		for (index = count = 0; index <= maxindex; index++) {
-			if ((ret = radix_tree_lookup(root_rnode, index, height))) {
-				fprintf(fp, "[%ld] %lx\n", index, (ulong) ret);
-				count++;
-			}
-		}
+		count = radix_tree_walk(radix_tree_rnode(root_rnode), height,
+			radix_tree_dump_entry, NULL);
 		break;
 
 	case RADIX_TREE_GATHER:
-		if (!(maxcount = rtp->index))
-			maxcount = (ulong) (-1);	/* caller beware */
-
-		for (index = count = 0, r = rtp; index <= maxindex; index++) {
-			if ((ret = radix_tree_lookup(root_rnode, index, height))) {
-				r->index = index;
-				r->value = ret;
-				count++;
-				if (--maxcount <= 0)
-					break;
-				r++;
-			}
-		}
+		gather.maxcount = rtp->index;
+		gather.rtp = rtp;
+		count = radix_tree_walk(radix_tree_rnode(root_rnode), height,
+			radix_tree_gather_entry, &gather);
 		break;
 
 	default:
@@ -3585,6 +3589,105 @@ ulong do_radix_tree(ulong root, int flag, struct radix_tree_pair * rtp)
 	return count;
 }
 
+static ulong radix_tree_rnode(ulong root_rnode)
+{
+	ulong rnode;
+
+	readmem(root_rnode, KVADDR, &rnode, sizeof(void *), "radix_tree_root rnode", FAULT_ON_ERROR);
+
+	return rnode & ~1UL;
+}
+
+/*
+ *  Walk the radix tree of the given height below node, depth-first and
+ *  in index order, calling callback with the index and value of each
+ *  entry found.  Each node's slots array is read once, and empty slots
+ *  are skipped without descending, so the cost is proportional to the
+ *  number of nodes rather than to the index space.  The walk stops
+ *  early if the callback returns FALSE.  The callback may be NULL to
+ *  just count the entries.  A tree of height 0 has node as its only
+ *  entry, at index 0.  Returns the number of entries passed to the
+ *  callback.
+ */
+ulong radix_tree_walk(ulong node, uint height, int (*callback)(ulong, ulong, void *), void *arg)
+{
+	ulong count;
+	ulong *slots;
+
+	count = 0;
+
+	if (!node)
+		return count;
+
+	if (!height) {
+		count++;
+		if (callback)
+			callback(0, node, arg);
+		return count;
+	}
+
+	radix_tree_init();
+
+	slots = (ulong *) GETBUF(sizeof(void *) * RADIX_TREE_MAP_SIZE * height);
+
+	radix_tree_walk_node(node, height, 0, slots, callback, arg, &count);
+
+	FREEBUF(slots);
+
+	return count;
+}
+
+static int radix_tree_walk_node(ulong node, uint height, ulong index, ulong *slots,
+	int (*callback)(ulong, ulong, void *), void *arg, ulong *count)
+{
+	int i;
+	ulong *s;
+
+	/*
+	 *  Each level of the recursion uses its own part of the slots buffer.
+	 */
+	s = &slots[(height - 1) * RADIX_TREE_MAP_SIZE];
+
+	readmem(node + OFFSET(radix_tree_node_slots), KVADDR, s,
+		sizeof(void *) * RADIX_TREE_MAP_SIZE, "radix_tree_node.slots array", FAULT_ON_ERROR);
+
+	for (i = 0; i < RADIX_TREE_MAP_SIZE; i++) {
+		if (!s[i])
+			continue;
+
+		if (height == 1) {
+			(*count)++;
+			if (callback && !callback((index << RADIX_TREE_MAP_SHIFT) | i, s[i], arg))
+				return FALSE;
+		} else if (!radix_tree_walk_node(s[i], height - 1,
+			   (index << RADIX_TREE_MAP_SHIFT) | i, slots, callback, arg, count))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int radix_tree_dump_entry(ulong index, ulong entry, void *arg)
+{
+	fprintf(fp, "[%ld] %lx\n", index, entry);
+
+	return TRUE;
+}
+
+static int radix_tree_gather_entry(ulong index, ulong entry, void *arg)
+{
+	struct radix_tree_gather *gather = (struct radix_tree_gather *)arg;
+
+	gather->rtp->index = index;
+	gather->rtp->value = (void *)entry;
+	gather->rtp++;
+
+	if (gather->maxcount && (--gather->maxcount == 0))
+		return FALSE;
+
+	return TRUE;
+}
+
 static void *radix_tree_lookup(ulong root_rnode, ulong index, int height)
 {
 	unsigned int shift;
@@ -256,6 +256,42 @@ static char *program_usage_info[] = {
 	"    this flag, reads from any of those pages will return zero-filled",
 	"    memory.",
 	"",
+	"  --page_cache size",
+	"    Set the size of the cache of physical pages that is shared by all",
+	"    dumpfile types, including the uncompressed pages of compressed",
+	"    kdump and diskdump dumpfiles.  The size may be suffixed with k, m",
+	"    or g; the default is 16m, and 0 or \"off\" disables the cache.",
+	"",
+	"  --flat_index directory",
+	"    Save the index of a flattened-format dumpfile's segments in the",
+	"    specified directory, in a \".flatidx\" file named after the",
+	"    dumpfile's name, device, inode, size and modification time, and",
+	"    use it in later sessions that open the same, unmodified dumpfile.",
+	"",
+	"  --type_cache directory",
+	"    Keep a cache of the kernel datatype lookups made during",
+	"    initialization in the specified directory, in a file named after",
+	"    the vmlinux build-id.  Later sessions against the same kernel read",
+	"    structure sizes and member offsets from it instead of gdb.",
+	"",
+	"  --dump_threads count",
+	"    Set the number of threads used to read ahead and uncompress pages",
+	"    when a sequential or strided scan of a compressed kdump dumpfile",
+	"    is detected.  The default is one less than the number of online",
+	"    cpus, up to 8; a count of 0 disables readahead.",
+	"",
+	"  --convert outfile [dumpfile]",
+	"    Rearrange a makedumpfile flattened-format dumpfile, or a flattened",
+	"    stream read from stdin if dumpfile is \"-\" or not specified, into",
+	"    the random-access kdump or ELF dumpfile outfile, which must not",
+	"    already exist.",
+	"",
+	"  --mmap_dump",
+	"    Map an uncompressed ELF kdump or netdump dumpfile into memory, so",
+	"    that reads are copied from the mapping instead of being issued as",
+	"    separate system calls, and physical memory searches are done in",
+	"    place.",
+	"",
 	"  --no_panic",
 	"    Do not attempt to find the task that was running when the kernel",
 	"    crashed.  Set the initial context to that of the \"swapper\"  task",
@@ -482,6 +518,7 @@ void cmd_help(void)
 		case 'n':
 		case 'D':
 			dumpfile_memory(DUMPFILE_MEM_DUMP);
+			dump_page_cache_dump(fp);
 			return;
 
 		case 'x':
@@ -497,6 +534,7 @@ void cmd_help(void)
 			return;
 		case 'm':
 			dump_machdep_table(0);
+			dump_vtop_cache(fp);
 			return;
 
 		case 'g':
@@ -618,9 +656,10 @@ void cmd_help(void)
 		cmd_usage(pc->curcmd, COMPLETE_HELP);
 
 	if (!args[optind]) {
-		if (oflag)
+		if (oflag) {
 			dump_offset_table(NULL, FALSE);
-		else
+			dump_datatype_cache(fp);
+		} else
 			display_help_screen("");
 		return;
 	}
@@ -976,6 +1015,10 @@ char *help_set[] = {
 	"        namelist  filename     name of kernel (from .%src file only).",
 	"   zero_excluded  on | off     controls whether excluded pages from a dumpfile",
 	"                               should return zero-filled memory.",
+	"      page_cache  size | off   sets the size of the dumpfile page cache that",
+	"                               is shared by all dumpfile types.",
+	"    dump_threads  count        sets the number of compressed dumpfile readahead",
+	"                               threads; 0 disables readahead.",
 	"       null-stop  on | off     if on, gdb's printing of character arrays will",
 	"                               stop at the first NULL encountered.",
 	"             gdb  on | off     if on, the %s session will be run in a mode",
@@ -1034,6 +1077,8 @@ char *help_set[] = {
 	"              edit: vi",
 	"          namelist: vmlinux",
 	"     zero_excluded: off",
+	"        page_cache: 16777216",
+	"      dump_threads: 7",
 	"         null-stop: on",
 	"               gdb: off",
 	"             scope: (not set)",
@@ -7080,6 +7080,7 @@ void clear_machdep_cache(void)
 		machdep->last_pgd_read = 0;
 		machdep->last_pmd_read = 0;
 		machdep->last_ptbl_read = 0;
+		vtop_cache_flush();
 		if (machdep->clear_machdep_cache)
 			machdep->clear_machdep_cache();
 	}
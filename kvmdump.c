@@ -21,7 +21,6 @@
 static struct kvmdump_data kvmdump_data = { 0 };
 
 struct kvmdump_data *kvm = &kvmdump_data;
-static int cache_page(physaddr_t);
 static int kvmdump_mapfile_exists(void);
 static off_t mapfile_offset(uint64_t);
 static void kvmdump_mapfile_create(char *);
@@ -31,10 +30,11 @@ static void write_mapfile_registers(void);
 static void write_mapfile_trailer(void);
 static void read_mapfile_trailer(void);
 static void read_mapfile_registers(void);
+static void kvmdump_map_flush(void);
+static void kvmdump_map_mmap(void);
 
 #define RAM_OFFSET_COMPRESSED (~(off_t)255)
-#define QEMU_COMPRESSED       ((WRITE_ERROR)-1)
-#define CACHE_UNUSED          (1ULL)
+#define MAP_COPY_BUFSIZE      (1024*1024)
 
 int is_kvmdump(char *filename)
 {
@@ -82,9 +82,7 @@ int is_kvmdump(char *filename)
 
 int kvmdump_init(char *filename, FILE * fptr)
 {
-	int i, page_size;
 	struct command_table_entry *cp;
-	char *cachebuf;
 	FILE *tmpfp;
 
 	if (!machine_type("X86") && !machine_type("X86_64")) {
@@ -94,7 +92,6 @@ int kvmdump_init(char *filename, FILE * fptr)
 
 	kvm->ofp = fptr;
 	kvm->debug = &pc->debug;
-	page_size = memory_page_size();
 
 #ifdef X86_64
 	kvm->kvbase = __START_KERNEL_map;
@@ -121,20 +118,13 @@ int kvmdump_init(char *filename, FILE * fptr)
 		break;
 	}
 
-	if ((cachebuf = calloc(1, KVMDUMP_CACHED_PAGES * page_size)) == NULL)
-		error(FATAL, "%s: cannot malloc KVM page_cache_buf\n");
-
-	for (i = 0; i < KVMDUMP_CACHED_PAGES; i++) {
-		kvm->page_cache[i].paddr = CACHE_UNUSED;
-		kvm->page_cache[i].bufptr = cachebuf + (i * page_size);
-	}
-
 	kvmdump_regs_store(KVMDUMP_REGS_START, NULL);
 
 	if (qemu_init(filename)) {
 		switch (kvm->flags & (TMPFILE | MAPFILE | MAPFILE_APPENDED)) {
 		case TMPFILE:
 			kvmdump_regs_store(KVMDUMP_REGS_END, NULL);
+			kvmdump_map_flush();
 			write_mapfile_trailer();
 			break;
 
@@ -143,6 +133,7 @@ int kvmdump_init(char *filename, FILE * fptr)
 		case MAPFILE | MAPFILE_APPENDED:
 			read_mapfile_trailer();
 			kvmdump_regs_store(KVMDUMP_REGS_END, NULL);
+			kvmdump_map_mmap();
 			break;
 		}
 
@@ -159,24 +150,30 @@ int kvmdump_init(char *filename, FILE * fptr)
 		return FALSE;
 }
 
+/*
+ *  Read straight from the QEMU savevm file; physical pages are cached
+ *  by the generic dump page cache in memory.c, of which this is the
+ *  fill function.  A compressed page is a single repeated byte.
+ */
 int read_kvmdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 {
-	switch (cache_page(PHYSPAGEBASE(paddr))) {
-	case READ_ERROR:
-		return READ_ERROR;
+	int err;
+	off_t offset;
 
-	case SEEK_ERROR:
-		return SEEK_ERROR;
+	kvm->accesses++;
 
-	case QEMU_COMPRESSED:
-		memset(bufptr, kvm->un.compressed, cnt);
-		break;
+	if ((err = load_mapfile_offset(PHYSPAGEBASE(paddr), &offset)) < 0)
+		return err;
 
-	default:
-		memcpy(bufptr, kvm->un.curbufptr + PAGEOFFSET(paddr), cnt);
-		break;
+	if ((offset & RAM_OFFSET_COMPRESSED) == RAM_OFFSET_COMPRESSED) {
+		kvm->compresses++;
+		memset(bufptr, (unsigned char)(offset & 255), cnt);
+		return cnt;
 	}
 
+	if (pread(kvm->vmfd, bufptr, cnt, offset + PAGEOFFSET(paddr)) != cnt)
+		return READ_ERROR;
+
 	return cnt;
 }
 
@@ -254,29 +251,19 @@ int kvmdump_memory_dump(FILE * ofp)
 	fprintf(ofp, "   map_start_offset: %llx\n", (ulonglong) kvm->mapinfo.map_start_offset);
 	fprintf(ofp, "           checksum: %llx\n", (ulonglong) kvm->mapinfo.checksum);
 
-	fprintf(ofp, "        curbufptr: %lx\n", (ulong) kvm->un.curbufptr);
-	fprintf(ofp, "      evict_index: %d\n", kvm->evict_index);
 	fprintf(ofp, "         accesses: %ld\n", kvm->accesses);
-	fprintf(ofp, "        hit_count: %ld ", kvm->hit_count);
-	if (kvm->accesses)
-		fprintf(ofp, "(%ld%%)\n", kvm->hit_count * 100 / kvm->accesses);
-	else
-		fprintf(ofp, "\n");
 	fprintf(ofp, "       compresses: %ld ", kvm->compresses);
 	if (kvm->accesses)
 		fprintf(ofp, "(%ld%%)\n", kvm->compresses * 100 / kvm->accesses);
 	else
 		fprintf(ofp, "\n");
 
-	for (i = 0; i < KVMDUMP_CACHED_PAGES; i++) {
-		if (kvm->page_cache[i].paddr == CACHE_UNUSED)
-			fprintf(ofp, "   %spage_cache[%d]: CACHE_UNUSED\n", i < 10 ? " " : "", i);
-		else
-			fprintf(ofp,
-				"   %spage_cache[%d]: bufptr: %lx  addr: %llx\n",
-				i < 10 ? " " : "", i,
-				(ulong) kvm->page_cache[i].bufptr, (ulonglong) kvm->page_cache[i].paddr);
-	}
+	fprintf(ofp, "              map: %lx (%s)\n", (ulong) kvm->map,
+		kvm->map_base ? "mmap'd" : kvm->map ? "in memory" : "not used");
+	fprintf(ofp, "      map_entries: %ld\n", kvm->map_entries);
+	fprintf(ofp, "    map_allocated: %ld\n", kvm->map_allocated);
+	fprintf(ofp, "         map_base: %lx\n", (ulong) kvm->map_base);
+	fprintf(ofp, "          map_len: %ld\n", (ulong) kvm->map_len);
 
 	fprintf(ofp, "      cpu_devices: %d\n", kvm->cpu_devices);
 	fprintf(ofp, "           iohole: %llx (%llx - %llx)\n",
@@ -471,58 +458,6 @@ int kvmdump_phys_base(unsigned long *phys_base)
 	return FALSE;
 }
 
-static int cache_page(physaddr_t paddr)
-{
-	int idx, err;
-	struct kvm_page_cache_hdr *pgc;
-	size_t page_size;
-	off_t offset;
-
-	kvm->accesses++;
-
-	for (idx = 0; idx < KVMDUMP_CACHED_PAGES; idx++) {
-		pgc = &kvm->page_cache[idx];
-
-		if (pgc->paddr == CACHE_UNUSED)
-			continue;
-
-		if (pgc->paddr == paddr) {
-			kvm->hit_count++;
-			kvm->un.curbufptr = pgc->bufptr;
-			return idx;
-		}
-	}
-
-	if ((err = load_mapfile_offset(paddr, &offset)) < 0)
-		return err;
-
-	if ((offset & RAM_OFFSET_COMPRESSED) == RAM_OFFSET_COMPRESSED) {
-		kvm->un.compressed = (unsigned char)(offset & 255);
-		kvm->compresses++;
-		return QEMU_COMPRESSED;
-	}
-
-	idx = kvm->evict_index;
-	pgc = &kvm->page_cache[idx];
-	page_size = memory_page_size();
-
-	if (lseek(kvm->vmfd, offset, SEEK_SET) < 0) {
-		pgc->paddr = CACHE_UNUSED;
-		return SEEK_ERROR;
-	}
-	if (read(kvm->vmfd, pgc->bufptr, page_size) != page_size) {
-		pgc->paddr = CACHE_UNUSED;
-		return READ_ERROR;
-	}
-
-	kvm->evict_index = (idx + 1) % KVMDUMP_CACHED_PAGES;
-
-	pgc->paddr = paddr;
-	kvm->un.curbufptr = pgc->bufptr;
-
-	return idx;
-}
-
 static off_t mapfile_offset(uint64_t physaddr)
 {
 	off_t offset = 0;
@@ -545,21 +480,35 @@ static off_t mapfile_offset(uint64_t physaddr)
 	return offset;
 }
 
+/*
+ *  While the dumpfile is being scanned, the map is built in memory,
+ *  and then written to the tmpfile with kvmdump_map_flush().
+ */
 int store_mapfile_offset(uint64_t physaddr, off_t * entry_ptr)
 {
-	if (lseek(kvm->mapfd, mapfile_offset(physaddr), SEEK_SET) < 0) {
-		error(INFO, "store_mapfile_offset: "
-		      "lseek error: physaddr: %llx  %s offset: %llx\n",
-		      (unsigned long long)physaddr, mapfile_in_use(), (unsigned long long)mapfile_offset(physaddr));
-		return SEEK_ERROR;
+	ulong index, count;
+	off_t *map;
+
+	index = physaddr / 4096;
+
+	if (index >= kvm->map_allocated) {
+		for (count = kvm->map_allocated ? kvm->map_allocated : 65536;
+		     count <= index; count *= 2)
+			;
+		if ((map = realloc(kvm->map, count * sizeof(off_t))) == NULL) {
+			error(INFO, "store_mapfile_offset: "
+			      "cannot realloc %ld-entry map: physaddr: %llx\n",
+			      count, (unsigned long long)physaddr);
+			return WRITE_ERROR;
+		}
+		BZERO(&map[kvm->map_allocated], (count - kvm->map_allocated) * sizeof(off_t));
+		kvm->map = map;
+		kvm->map_allocated = count;
 	}
 
-	if (write(kvm->mapfd, entry_ptr, sizeof(off_t)) != sizeof(off_t)) {
-		error(INFO, "store_mapfile_offset: "
-		      "write error: physaddr: %llx  %s offset: %llx\n",
-		      (unsigned long long)physaddr, mapfile_in_use(), (unsigned long long)mapfile_offset(physaddr));
-		return WRITE_ERROR;
-	}
+	kvm->map[index] = *entry_ptr;
+	if (index >= kvm->map_entries)
+		kvm->map_entries = index + 1;
 
 	return 0;
 }
@@ -586,16 +535,20 @@ int load_mapfile_offset(uint64_t physaddr, off_t * entry_ptr)
 		break;
 	}
 
-	if (lseek(kvm->mapfd, mapfile_offset(kvm_addr), SEEK_SET) < 0) {
-		if (CRASHDEBUG(1))
-			error(INFO, "load_mapfile_offset: "
-			      "lseek error: physical: %llx  %s offset: %llx\n",
-			      (unsigned long long)physaddr, mapfile_in_use(),
-			      (unsigned long long)mapfile_offset(kvm_addr));
-		return SEEK_ERROR;
+	if (kvm->map) {
+		if ((kvm_addr / 4096) >= kvm->map_entries) {
+			if (CRASHDEBUG(1))
+				error(INFO, "load_mapfile_offset: "
+				      "beyond map: physical: %llx  %s entries: %ld\n",
+				      (unsigned long long)physaddr, mapfile_in_use(),
+				      kvm->map_entries);
+			return READ_ERROR;
+		}
+		*entry_ptr = kvm->map[kvm_addr / 4096];
+		return 0;
 	}
 
-	if (read(kvm->mapfd, entry_ptr, sizeof(off_t)) != sizeof(off_t)) {
+	if (pread(kvm->mapfd, entry_ptr, sizeof(off_t), mapfile_offset(kvm_addr)) != sizeof(off_t)) {
 		if (CRASHDEBUG(1))
 			error(INFO, "load_mapfile_offset: "
 			      "read error: physical: %llx  %s offset: %llx\n",
@@ -607,11 +560,66 @@ int load_mapfile_offset(uint64_t physaddr, off_t * entry_ptr)
 	return 0;
 }
 
+/*
+ *  Write the in-memory map built during the dumpfile scan to the start
+ *  of the tmpfile, where the registers and the trailer will follow it.
+ */
+static void kvmdump_map_flush(void)
+{
+	char *buf;
+	size_t size;
+	ssize_t cnt;
+	off_t offset;
+
+	buf = (char *)kvm->map;
+	size = kvm->map_entries * sizeof(off_t);
+
+	for (offset = 0; size; offset += cnt, size -= cnt) {
+		if ((cnt = pwrite(kvm->mapfd, buf + offset, MIN(size, MAP_COPY_BUFSIZE), offset)) <= 0)
+			error(FATAL, "%s: write: %s\n", mapfile_in_use(), strerror(errno));
+	}
+}
+
+/*
+ *  Map the map of an existing mapfile, or of a dumpfile that has one
+ *  appended, so that load_mapfile_offset() needs no system calls.  If
+ *  that fails, the map entries are read from the file.
+ */
+static void kvmdump_map_mmap(void)
+{
+	off_t eof, start, aligned;
+	char *base;
+
+	if ((kvm->flags & (TMPFILE | MAPFILE | MAPFILE_APPENDED)) == MAPFILE_APPENDED)
+		start = kvm->mapinfo.map_start_offset;
+	else
+		start = 0;
+
+	if ((eof = lseek(kvm->mapfd, 0, SEEK_END)) <= start)
+		return;
+
+	aligned = start & ~((off_t)sysconf(_SC_PAGESIZE) - 1);
+	if ((size_t)(eof - aligned) != (eof - aligned))
+		return;
+
+	base = mmap(NULL, eof - aligned, PROT_READ, MAP_SHARED, kvm->mapfd, aligned);
+	if (base == MAP_FAILED) {
+		if (CRASHDEBUG(1))
+			error(INFO, "%s: mmap: %s\n", mapfile_in_use(), strerror(errno));
+		return;
+	}
+
+	kvm->map_base = base;
+	kvm->map_len = eof - aligned;
+	kvm->map = (off_t *)(base + (start - aligned));
+	kvm->map_entries = (eof - start) / sizeof(off_t);
+}
+
 static void kvmdump_mapfile_create(char *filename)
 {
 	int fdmem, n;
 	off_t offset;
-	char buf[4096];
+	char *buf;
 
 	if (kvm->flags & MAPFILE) {
 		error(INFO, "%s: mapfile in use\n", pc->kvmdump_mapfile);
@@ -630,18 +638,21 @@ static void kvmdump_mapfile_create(char *filename)
 
 	offset = kvm->mapinfo.map_start_offset;
 
-	if (lseek(kvm->mapfd, offset, SEEK_SET) < 0) {
-		error(INFO, "%s: leek: %s\n", mapfile_in_use(), strerror(errno));
+	if ((buf = malloc(MAP_COPY_BUFSIZE)) == NULL) {
+		error(INFO, "%s: cannot malloc copy buffer\n", filename);
+		close(fdmem);
 		return;
 	}
 
-	while ((n = read(kvm->mapfd, buf, 4096)) > 0) {
+	while ((n = pread(kvm->mapfd, buf, MAP_COPY_BUFSIZE, offset)) > 0) {
 		if (write(fdmem, buf, n) != n) {
 			error(INFO, "%s: write: %s\n", filename, strerror(errno));
 			break;
 		}
+		offset += n;
 	}
 
+	free(buf);
 	close(fdmem);
 
 	fprintf(fp, "MAP FILE CREATED: %s\n", filename);
@@ -653,8 +664,8 @@ static void kvmdump_mapfile_append(void)
 	ulong round_bytes;
 	struct stat statbuf;
 	uint64_t map_start_offset;
-	off_t eof, orig_dumpfile_size;
-	char buf[4096];
+	off_t eof, offset, orig_dumpfile_size;
+	char buf[4096], *copybuf;
 
 	if (kvm->flags & MAPFILE_APPENDED)
 		error(FATAL, "mapfile already appended to %s\n", pc->dumpfile);
@@ -688,17 +699,19 @@ static void kvmdump_mapfile_append(void)
 
 	map_start_offset = orig_dumpfile_size + round_bytes;
 
-	if (lseek(kvm->mapfd, 0, SEEK_SET) != 0) {
-		error(INFO, "%s: lseek: %s\n", mapfile_in_use(), strerror(errno));
+	if ((copybuf = malloc(MAP_COPY_BUFSIZE)) == NULL) {
+		error(INFO, "cannot malloc copy buffer\n");
 		goto bailout2;
 	}
 
-	while ((n = read(kvm->mapfd, buf, 4096)) > 0) {
-		if (write(fdcore, buf, n) != n) {
+	for (offset = 0; (n = pread(kvm->mapfd, copybuf, MAP_COPY_BUFSIZE, offset)) > 0; offset += n) {
+		if (write(fdcore, copybuf, n) != n) {
 			error(INFO, "%s: write: %s\n", pc->dumpfile, strerror(errno));
+			free(copybuf);
 			goto bailout2;
 		}
 	}
+	free(copybuf);
 
 	/*
 	 *  Overwrite the map_start_offset value in the trailer to reflect
@@ -40,8 +40,6 @@ struct register_set {
 #define MAPFILE_MAGIC (0xfeedbabedeadbeefULL)
 #define CHKSUM_SIZE   (4096)
 
-#define KVMDUMP_CACHED_PAGES 32
-
 struct kvmdump_data {
 	ulong flags;
 	FILE *ofp;
@@ -49,19 +47,14 @@ struct kvmdump_data {
 	int mapfd;
 	int vmfd;
 	struct mapinfo_trailer mapinfo;
-	/* page cache */
-	struct kvm_page_cache_hdr {
-		uint64_t paddr;
-		char *bufptr;
-	} page_cache[KVMDUMP_CACHED_PAGES];
-	union {
-		char *curbufptr;
-		unsigned char compressed;
-	} un;
-	int evict_index;
 	ulong accesses;
-	ulong hit_count;
 	ulong compresses;
+	/* pfn-to-offset map */
+	off_t *map;		/* map array, in memory or mmap'd */
+	ulong map_entries;	/* valid map entries */
+	ulong map_allocated;	/* allocated entries, if in memory */
+	char *map_base;		/* base of mapfile mapping */
+	size_t map_len;
 	uint64_t kvbase;
 	ulong *debug;
 	uint32_t cpu_devices;
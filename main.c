@@ -29,6 +29,7 @@ static void check_xen_hyper(void);
 static void show_untrusted_files(void);
 static void get_osrelease(char *);
 static void get_log(char *);
+static void convert_dumpfile(char *, char *);
 
 static struct option long_options[] = {
 	{"memory_module", required_argument, 0, 0},
@@ -68,13 +69,19 @@ static struct option long_options[] = {
 	{"hex", 0, 0, 0},
 	{"dec", 0, 0, 0},
 	{"no_strip", 0, 0, 0},
+	{"page_cache", required_argument, 0, 0},
+	{"type_cache", required_argument, 0, 0},
+	{"flat_index", required_argument, 0, 0},
+	{"dump_threads", required_argument, 0, 0},
+	{"mmap_dump", 0, 0, 0},
+	{"convert", required_argument, 0, 0},
 	{0, 0, 0, 0}
 };
 
 int main(int argc, char **argv)
 {
 	int i, c, option_index;
-	char *tmpname;
+	char *tmpname, *convert_file;
 
 	setup_environment(argc, argv);
 
@@ -83,6 +90,7 @@ int main(int argc, char **argv)
 	 */
 	opterr = 0;
 	optind = 0;
+	convert_file = NULL;
 	while ((c = getopt_long(argc, argv, "Lkgh::e:i:sSvc:d:tfp:m:x", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 0:
@@ -154,6 +162,21 @@ int main(int argc, char **argv)
 			else if (STREQ(long_options[option_index].name, "zero_excluded"))
 				*diskdump_flags |= ZERO_EXCLUDED;
 
+			else if (STREQ(long_options[option_index].name, "page_cache"))
+				set_dump_page_cache(optarg);
+
+			else if (STREQ(long_options[option_index].name, "type_cache"))
+				set_datatype_cache(optarg);
+
+			else if (STREQ(long_options[option_index].name, "flat_index"))
+				set_flat_index_dir(optarg);
+
+			else if (STREQ(long_options[option_index].name, "dump_threads"))
+				set_diskdump_threads(optarg);
+
+			else if (STREQ(long_options[option_index].name, "mmap_dump"))
+				pc->flags2 |= MMAP_DUMPFILE;
+
 			else if (STREQ(long_options[option_index].name, "no_elf_notes")) {
 				if (machine_type("X86")
 				    || machine_type("X86_64"))
@@ -225,6 +248,9 @@ int main(int argc, char **argv)
 				get_log(optarg);
 			}
 
+			else if (STREQ(long_options[option_index].name, "convert"))
+				convert_file = optarg;
+
 			else if (STREQ(long_options[option_index].name, "hex")) {
 				pc->flags2 |= RADIX_OVERRIDE;
 				pc->output_radix = 16;
@@ -346,6 +372,9 @@ int main(int argc, char **argv)
 	}
 	opterr = 1;
 
+	if (convert_file)
+		convert_dumpfile(convert_file, argv[optind]);
+
 	display_version();
 
 	/*
@@ -642,6 +671,8 @@ void main_loop(void)
 	if (pc->flags & MINIMAL_MODE)
 		error(NOTE, "minimal mode commands: log, dis, rd, sym, eval, set, extend and exit\n\n");
 
+	datatype_cache_save();
+
 	pc->flags |= RUNTIME;
 
 	if (pc->flags & PRELOAD_EXTENSIONS)
@@ -1640,3 +1671,22 @@ static void get_log(char *dumpfile)
 
 	clean_exit(retval);
 }
+
+/*
+ *  Rearrange a flattened-format dumpfile, or a flattened-format stream
+ *  read from stdin, into a random-access dumpfile.
+ */
+static void convert_dumpfile(char *outfile, char *dumpfile)
+{
+	if (dumpfile && (dumpfile[0] == '-') && dumpfile[1]) {
+		error(INFO, "invalid --convert dumpfile argument: %s\n", dumpfile);
+		program_usage(SHORT_FORM);
+	}
+
+	if (!dumpfile && isatty(fileno(stdin))) {
+		error(INFO, "--convert: no dumpfile argument, and stdin is a terminal\n");
+		program_usage(SHORT_FORM);
+	}
+
+	clean_exit(convert_flattened_format(dumpfile, outfile) ? 0 : 1);
+}
@@ -34,12 +34,43 @@ struct all_flat_data {
 	unsigned long long num_array;
 	struct flat_data *array;
 	size_t file_size;
+	time_t file_mtime;
+	unsigned long long last_index;	/* segment of the last read */
+	ulong index_source;
+	ulong hint_hits;
+	ulong searches;
 };
 
 struct all_flat_data afd;
 
 struct makedumpfile_header fh_save;
 
+#define FLAT_INDEX_BUILT	(1)
+#define FLAT_INDEX_LOADED	(2)
+
+/*
+ *  If a directory is given with --flat_index, the sorted flat_data array
+ *  is saved there in a ".flatidx" file, so that subsequent sessions
+ *  can skip the scan of the segment headers.  The file is only used if
+ *  its header matches the size and modification time of the dumpfile.
+ */
+#define FLAT_INDEX_SUFFIX	".flatidx"
+#define FLAT_INDEX_MAGIC	"crash flatidx\n"
+#define FLAT_INDEX_VERSION	(1)
+
+static char *flat_index_dir = NULL;
+
+struct flat_index_header {
+	char magic[16];
+	int64_t version;
+	int64_t file_size;
+	int64_t file_mtime;
+	int64_t num_array;
+	int64_t entry_size;
+};
+
+#define FLAT_READ_BUFSIZE	(1024*1024)
+
 static int is_bigendian(void)
 {
 	int i = 0x12345678;
@@ -50,40 +81,70 @@ static int is_bigendian(void)
 		return FALSE;
 }
 
+/*
+ *  Read a makedumpfile_data_header at the given file offset, refilling
+ *  the read-ahead buffer only when the header is not already contained
+ *  in it.  Since the segment data is typically small, most headers are
+ *  found in the buffer, and skipping over the data requires no lseek().
+ */
+static int read_flat_data_header(int fd, char *buf, int64_t *buf_offset,
+	ssize_t *buf_len, int64_t offset, struct makedumpfile_data_header *fdh)
+{
+	ssize_t len;
+
+	if ((offset < *buf_offset) ||
+	    ((offset + (int64_t)sizeof(*fdh)) > (*buf_offset + *buf_len))) {
+		len = pread(fd, buf, FLAT_READ_BUFSIZE, (off_t)offset);
+		if (len < (ssize_t)sizeof(*fdh))
+			return FALSE;
+		*buf_offset = offset;
+		*buf_len = len;
+	}
+
+	BCOPY(buf + (offset - *buf_offset), fdh, sizeof(*fdh));
+
+	return TRUE;
+}
+
 static unsigned long long store_flat_data_array(char *file, struct flat_data **fda)
 {
 	int result = FALSE, fd;
-	int64_t offset_fdh;
+	int64_t offset_fdh, buf_offset;
+	ssize_t buf_len;
 	unsigned long long num_allocated = 0;
 	unsigned long long num_stored = 0;
 	unsigned long long size_allocated;
-	struct flat_data *ptr = NULL, *cur;
+	struct flat_data *ptr = NULL, *new, *cur;
 	struct makedumpfile_data_header fdh;
+	char *buf;
 
 	fd = open(file, O_RDONLY);
 	if (fd < 0) {
 		error(INFO, "unable to open dump file %s\n", file);
 		return -1;
 	}
-	if (lseek(fd, MAX_SIZE_MDF_HEADER, SEEK_SET) < 0) {
-		error(INFO, "%s: seek error (flat format)\n", file);
+	if ((buf = malloc(FLAT_READ_BUFSIZE)) == NULL) {
+		error(INFO, "unable to malloc flat format read buffer\n");
 		close(fd);
 		return -1;
 	}
+	buf_offset = buf_len = 0;
+	offset_fdh = MAX_SIZE_MDF_HEADER;
+
 	while (1) {
 		if (num_allocated <= num_stored) {
-			num_allocated += 100;
+			num_allocated = num_allocated ? num_allocated * 2 : 1024;
 			size_allocated = sizeof(struct flat_data)
 			    * num_allocated;
-			ptr = realloc(ptr, size_allocated);
-			if (ptr == NULL) {
+			if ((new = realloc(ptr, size_allocated)) == NULL) {
 				error(INFO, "unable to realloc flat_data structures\n");
 				break;
 			}
+			ptr = new;
 		}
-		offset_fdh = lseek(fd, 0x0, SEEK_CUR);
 
-		if (read(fd, &fdh, sizeof(fdh)) < 0) {
+		if (!read_flat_data_header(fd, buf, &buf_offset, &buf_len,
+		    offset_fdh, &fdh)) {
 			error(INFO, "read error: %s (flat format)\n", file);
 			break;
 		}
@@ -95,19 +156,21 @@ static unsigned long long store_flat_data_array(char *file, struct flat_data **f
 			result = TRUE;
 			break;
 		}
+		if ((fdh.offset < 0) || (fdh.buf_size < 0)) {
+			error(INFO, "%s: invalid data header (flat format)\n", file);
+			break;
+		}
 		cur = ptr + num_stored;
 		cur->off_flattened = offset_fdh + sizeof(fdh);
 		cur->off_rearranged = fdh.offset;
 		cur->buf_size = fdh.buf_size;
 		num_stored++;
 
-		/* seek for next makedumpfile_data_header. */
-		if (lseek(fd, fdh.buf_size, SEEK_CUR) < 0) {
-			error(INFO, "%s: seek error (flat format)\n", file);
-			break;
-		}
+		/* skip the data to the next makedumpfile_data_header. */
+		offset_fdh += sizeof(fdh) + fdh.buf_size;
 	}
 	close(fd);
+	free(buf);
 	if (result == FALSE) {
 		free(ptr);
 		return -1;
@@ -117,32 +180,183 @@ static unsigned long long store_flat_data_array(char *file, struct flat_data **f
 	return num_stored;
 }
 
+/*
+ *  Segments that rewrite the same offset are kept in the order that
+ *  they appear in the stream.
+ */
+static int compare_flat_data(const void *v1, const void *v2)
+{
+	const struct flat_data *f1 = v1, *f2 = v2;
+
+	if (f1->off_rearranged != f2->off_rearranged)
+		return f1->off_rearranged < f2->off_rearranged ? -1 : 1;
+	if (f1->off_flattened != f2->off_flattened)
+		return f1->off_flattened < f2->off_flattened ? -1 : 1;
+	return 0;
+}
+
 static void sort_flat_data_array(struct flat_data **fda, unsigned long long num_fda)
 {
-	unsigned long long i, j;
-	struct flat_data tmp, *cur_i, *cur_j;
+	unsigned long long i;
+	struct flat_data *array = *fda;
+
+	/*
+	 *  makedumpfile mostly writes in ascending offset order, so
+	 *  check whether there's anything to do first.
+	 */
+	for (i = 1; i < num_fda; i++) {
+		if (compare_flat_data(&array[i-1], &array[i]) > 0)
+			break;
+	}
+	if (i >= num_fda)
+		return;
 
-	for (i = 0; i < num_fda - 1; i++) {
-		for (j = i + 1; j < num_fda; j++) {
-			cur_i = *fda + i;
-			cur_j = *fda + j;
+	qsort(array, num_fda, sizeof(struct flat_data), compare_flat_data);
+}
 
-			if (cur_i->off_rearranged < cur_j->off_rearranged)
-				continue;
+/*
+ *  Set the directory that holds the .flatidx files.
+ */
+void set_flat_index_dir(char *dir)
+{
+	struct stat sbuf;
 
-			tmp.off_flattened = cur_i->off_flattened;
-			tmp.off_rearranged = cur_i->off_rearranged;
-			tmp.buf_size = cur_i->buf_size;
+	if ((stat(dir, &sbuf) < 0) || !S_ISDIR(sbuf.st_mode)) {
+		error(INFO, "--flat_index: %s: not a directory\n", dir);
+		return;
+	}
 
-			cur_i->off_flattened = cur_j->off_flattened;
-			cur_i->off_rearranged = cur_j->off_rearranged;
-			cur_i->buf_size = cur_j->buf_size;
+	flat_index_dir = dir;
+}
 
-			cur_j->off_flattened = tmp.off_flattened;
-			cur_j->off_rearranged = tmp.off_rearranged;
-			cur_j->buf_size = tmp.buf_size;
-		}
+/*
+ *  Dumpfiles are commonly all called "vmcore", so the index file name
+ *  carries the device, inode, size and modification time of the dumpfile
+ *  as well as its name.
+ */
+static char *flat_index_filename(char *file)
+{
+	char *name, *base;
+	struct stat sbuf;
+
+	if (!flat_index_dir || (stat(file, &sbuf) < 0))
+		return NULL;
+
+	base = basename(file);
+	if ((name = malloc(strlen(flat_index_dir) + strlen(base) + strlen(FLAT_INDEX_SUFFIX) + 80)))
+		sprintf(name, "%s/%s-%llx-%llx-%llx-%llx%s", flat_index_dir, base,
+			(ulonglong)sbuf.st_dev, (ulonglong)sbuf.st_ino,
+			(ulonglong)sbuf.st_size, (ulonglong)sbuf.st_mtime,
+			FLAT_INDEX_SUFFIX);
+
+	return name;
+}
+
+static int load_flat_index(char *file)
+{
+	int fd;
+	char *name;
+	size_t size;
+	struct flat_index_header fih;
+	struct flat_data *fda;
+
+	if (!(name = flat_index_filename(file)))
+		return FALSE;
+	if ((fd = open(name, O_RDONLY)) < 0) {
+		free(name);
+		return FALSE;
+	}
+
+	fda = NULL;
+	if (read(fd, &fih, sizeof(fih)) != sizeof(fih))
+		goto bailout;
+	if (!STRNEQ(fih.magic, FLAT_INDEX_MAGIC) ||
+	    (fih.version != FLAT_INDEX_VERSION) ||
+	    (fih.entry_size != sizeof(struct flat_data)) ||
+	    (fih.file_size != (int64_t)afd.file_size) ||
+	    (fih.file_mtime != (int64_t)afd.file_mtime) ||
+	    (fih.num_array <= 0))
+		goto bailout;
+
+	size = fih.num_array * sizeof(struct flat_data);
+	if ((fda = malloc(size)) == NULL)
+		goto bailout;
+	if (read(fd, fda, size) != size)
+		goto bailout;
+	close(fd);
+
+	afd.num_array = fih.num_array;
+	afd.array = fda;
+	afd.index_source = FLAT_INDEX_LOADED;
+
+	if (CRASHDEBUG(1))
+		fprintf(fp, "%s: loaded %lld flat_data entries from %s\n",
+			file, (ulonglong)afd.num_array, name);
+	free(name);
+
+	return TRUE;
+
+bailout:
+	if (CRASHDEBUG(1))
+		error(INFO, "%s: stale or invalid index file ignored\n", name);
+	free(name);
+	free(fda);
+	close(fd);
+	return FALSE;
+}
+
+/*
+ *  Saving the index is strictly best-effort; the dumpfile directory
+ *  may well be read-only.  The index is written to a temporary file
+ *  and renamed so that a concurrent session never sees a partial one.
+ */
+static void save_flat_index(char *file)
+{
+	int fd, ok;
+	char *name, *tmpname;
+	size_t size;
+	struct flat_index_header fih;
+
+	if (!(name = flat_index_filename(file)))
+		return;
+	if (!(tmpname = malloc(strlen(name) + 32))) {
+		free(name);
+		return;
+	}
+	sprintf(tmpname, "%s.%d", name, (int)getpid());
+
+	fd = open(tmpname, O_WRONLY|O_CREAT|O_EXCL, 0644);
+	if (fd < 0) {
+		if (CRASHDEBUG(1))
+			error(INFO, "cannot create %s: %s\n",
+				tmpname, strerror(errno));
+		goto out;
 	}
+
+	BZERO(&fih, sizeof(fih));
+	strncpy(fih.magic, FLAT_INDEX_MAGIC, sizeof(fih.magic));
+	fih.version = FLAT_INDEX_VERSION;
+	fih.file_size = afd.file_size;
+	fih.file_mtime = afd.file_mtime;
+	fih.num_array = afd.num_array;
+	fih.entry_size = sizeof(struct flat_data);
+	size = afd.num_array * sizeof(struct flat_data);
+
+	ok = (write(fd, &fih, sizeof(fih)) == sizeof(fih)) &&
+	     (write(fd, afd.array, size) == size);
+	if (close(fd) < 0)
+		ok = FALSE;
+
+	if (!ok || (rename(tmpname, name) < 0)) {
+		if (CRASHDEBUG(1))
+			error(INFO, "cannot write %s\n", name);
+		unlink(tmpname);
+	} else if (CRASHDEBUG(1))
+		fprintf(fp, "%s: saved %lld flat_data entries\n",
+			name, (ulonglong)afd.num_array);
+out:
+	free(tmpname);
+	free(name);
 }
 
 static int read_all_makedumpfile_data_header(char *file)
@@ -150,6 +364,14 @@ static int read_all_makedumpfile_data_header(char *file)
 	unsigned long long num;
 	struct flat_data *fda = NULL;
 	long long retval;
+	struct stat sbuf;
+
+	if (!stat(file, &sbuf) && S_ISREG(sbuf.st_mode)) {
+		afd.file_size = sbuf.st_size;
+		afd.file_mtime = sbuf.st_mtime;
+		if (load_flat_index(file))
+			return TRUE;
+	}
 
 	retval = num = store_flat_data_array(file, &fda);
 	if (retval < 0)
@@ -159,6 +381,10 @@ static int read_all_makedumpfile_data_header(char *file)
 
 	afd.num_array = num;
 	afd.array = fda;
+	afd.index_source = FLAT_INDEX_BUILT;
+
+	if (afd.file_size && num)
+		save_flat_index(file);
 
 	return TRUE;
 }
@@ -218,67 +444,90 @@ static int read_raw_dump_file(int fd, off_t offset, void *buf, size_t size)
 	return TRUE;
 }
 
-int read_flattened_format(int fd, off_t offset, void *buf, size_t size)
+/*
+ *  Return the index of the last segment starting at or below the
+ *  offset, or -1 if the offset precedes all of them.  Since pages are
+ *  mostly read in ascending order, the segment used by the last read,
+ *  and the one following it, are checked before the binary search.
+ */
+static long long flat_data_index(off_t offset)
 {
 	unsigned long long index, index_start, index_end;
-	int64_t range_start, range_end;
-	size_t read_size, remain_size;
-	off_t offset_read;
 	struct flat_data *ptr;
 
+	if (!afd.num_array)
+		return -1;
+
+	for (index = afd.last_index;
+	     (index < afd.num_array) && (index <= afd.last_index + 1); index++) {
+		ptr = afd.array + index;
+		if ((ptr->off_rearranged <= offset) &&
+		    ((index + 1 == afd.num_array) ||
+		     (offset < (ptr + 1)->off_rearranged))) {
+			afd.hint_hits++;
+			return (afd.last_index = index);
+		}
+	}
+
+	afd.searches++;
+
+	if (offset < afd.array[0].off_rearranged)
+		return -1;
+
 	index_start = 0;
 	index_end = afd.num_array;
 
-	while (1) {
+	while (index_start + 1 < index_end) {
 		index = (index_start + index_end) / 2;
-		ptr = afd.array + index;
-		range_start = ptr->off_rearranged;
-		range_end = ptr->off_rearranged + ptr->buf_size;
+		if (afd.array[index].off_rearranged <= offset)
+			index_start = index;
+		else
+			index_end = index;
+	}
 
-		if ((range_start <= offset) && (offset < range_end)) {
-			/* Found a corresponding array. */
-			offset_read = (offset - range_start) + ptr->off_flattened;
+	return (afd.last_index = index_start);
+}
 
-			if (offset + size <= range_end) {
-				if (!read_raw_dump_file(fd, offset_read, buf, size))
-					return FALSE;
-				break;
-			}
+int read_flattened_format(int fd, off_t offset, void *buf, size_t size)
+{
+	long long index;
+	int64_t range_start, range_end;
+	size_t read_size;
+	off_t offset_read;
+	struct flat_data *ptr;
 
-			/* Searh other array corresponding to remaining data. */
-			read_size = range_end - offset;
-			remain_size = size - read_size;
+	while (size) {
+		index = flat_data_index(offset);
+		ptr = index < 0 ? NULL : afd.array + index;
+
+		if (ptr && (offset < ptr->off_rearranged + ptr->buf_size)) {
+			/* Found a corresponding array. */
+			range_start = ptr->off_rearranged;
+			range_end = ptr->off_rearranged + ptr->buf_size;
+			offset_read = (offset - range_start) + ptr->off_flattened;
+			read_size = MIN(size, range_end - offset);
 			if (!read_raw_dump_file(fd, offset_read, buf, read_size))
 				return FALSE;
-			if (!read_flattened_format(fd, offset + read_size, (char *)buf + read_size, remain_size))
-				return FALSE;
-			break;
-
-		} else if ((index == index_start)
-			   && (index_start + 1 == index_end)) {
+		} else {
 			/*
 			 * Try to read not-written area. That is a common case,
 			 * because the area might be skipped by lseek().
 			 * This area should be the data filled with zero.
 			 */
-			ptr = afd.array + index_end;
-			if (offset + size <= ptr->off_rearranged) {
-				memset(buf, 0x0, size);
-			} else {
-				read_size = ptr->off_rearranged - offset;
-				remain_size = size - read_size;
-				memset(buf, 0x0, read_size);
-				if (!read_flattened_format(fd,
-							   offset + read_size, (char *)buf + read_size, remain_size))
-					return FALSE;
-			}
-			break;
+			ptr = afd.array + (index + 1);
+			if ((index + 1) >= (long long)afd.num_array)
+				read_size = size;
+			else
+				read_size = MIN(size, ptr->off_rearranged - offset);
+			memset(buf, 0x0, read_size);
+		}
 
-		} else if (offset < ptr->off_rearranged)
-			index_end = index;
-		else
-			index_start = index;
+		/* Continue with the array corresponding to remaining data. */
+		offset += read_size;
+		buf = (char *)buf + read_size;
+		size -= read_size;
 	}
+
 	return TRUE;
 }
 
@@ -306,5 +555,235 @@ void dump_flat_header(FILE * ofp)
 	fprintf(ofp, "      all_flat_data:\n");
 	fprintf(ofp, "          num_array: %lld\n", (ulonglong) afd.num_array);
 	fprintf(ofp, "              array: %lx\n", (ulong) afd.array);
-	fprintf(ofp, "          file_size: %ld\n\n", (ulong) afd.file_size);
+	fprintf(ofp, "          file_size: %ld\n", (ulong) afd.file_size);
+	fprintf(ofp, "         file_mtime: %ld\n", (ulong) afd.file_mtime);
+	fprintf(ofp, "         last_index: %lld\n", (ulonglong) afd.last_index);
+	fprintf(ofp, "       index_source: %s\n",
+		afd.index_source == FLAT_INDEX_LOADED ? "loaded from " FLAT_INDEX_SUFFIX " file" :
+		afd.index_source == FLAT_INDEX_BUILT ? "built from data headers" : "(none)");
+	fprintf(ofp, "          hint_hits: %ld\n", afd.hint_hits);
+	fprintf(ofp, "           searches: %ld\n\n", afd.searches);
+}
+
+/*
+ *  Support for "crash --convert outfile [dumpfile]", which rearranges
+ *  a flattened-format stream, read from a file or from stdin, into the
+ *  random-access kdump-compressed or ELF dumpfile that makedumpfile
+ *  would have written, in the same manner as "makedumpfile -R".
+ *  The input is consumed in one sequential pass, and the segments are
+ *  gathered into large buffers so that contiguous data is written out
+ *  with a single pwrite().  Unwritten areas are left as file holes.
+ */
+#define FLAT_CONVERT_BUFSIZE	(4*1024*1024)
+
+struct flat_stream {
+	int fd;
+	char *name;
+	char *buf;
+	size_t pos;
+	size_t len;
+	ulonglong total;
+};
+
+static int flat_stream_read(struct flat_stream *fs, void *dest, size_t size)
+{
+	size_t cnt;
+	ssize_t len;
+
+	while (size) {
+		if (fs->pos == fs->len) {
+			len = read(fs->fd, fs->buf, FLAT_CONVERT_BUFSIZE);
+			if (len < 0) {
+				if (errno == EINTR)
+					continue;
+				error(INFO, "%s: read error: %s\n",
+					fs->name, strerror(errno));
+				return FALSE;
+			}
+			if (len == 0) {
+				error(INFO, "%s: unexpected end of file (flat format)\n",
+					fs->name);
+				return FALSE;
+			}
+			fs->pos = 0;
+			fs->len = len;
+		}
+		cnt = MIN(size, fs->len - fs->pos);
+		if (dest) {
+			BCOPY(fs->buf + fs->pos, dest, cnt);
+			dest = (char *)dest + cnt;
+		}
+		fs->pos += cnt;
+		fs->total += cnt;
+		size -= cnt;
+	}
+
+	return TRUE;
+}
+
+struct flat_output {
+	int fd;
+	char *name;
+	char *buf;
+	int64_t offset;		/* file offset of buf[0] */
+	size_t len;
+	int64_t file_size;
+	ulong writes;
+};
+
+static int flat_output_flush(struct flat_output *fo)
+{
+	ssize_t len;
+	size_t done;
+
+	for (done = 0; done < fo->len; done += len) {
+		len = pwrite(fo->fd, fo->buf + done, fo->len - done,
+			(off_t)(fo->offset + done));
+		if (len < 0) {
+			if (errno == EINTR) {
+				len = 0;
+				continue;
+			}
+			error(INFO, "%s: write error: %s\n",
+				fo->name, strerror(errno));
+			return FALSE;
+		}
+	}
+	if (fo->len)
+		fo->writes++;
+	fo->offset += fo->len;
+	fo->len = 0;
+
+	return TRUE;
+}
+
+static int flat_convert_segment(struct flat_stream *fs, struct flat_output *fo,
+	int64_t offset, int64_t size)
+{
+	size_t cnt;
+
+	if (fo->len && (offset != fo->offset + (int64_t)fo->len)) {
+		if (!flat_output_flush(fo))
+			return FALSE;
+	}
+	if (!fo->len)
+		fo->offset = offset;
+
+	while (size) {
+		if (fo->len == FLAT_CONVERT_BUFSIZE) {
+			if (!flat_output_flush(fo))
+				return FALSE;
+		}
+		cnt = MIN(size, FLAT_CONVERT_BUFSIZE - fo->len);
+		if (!flat_stream_read(fs, fo->buf + fo->len, cnt))
+			return FALSE;
+		fo->len += cnt;
+		size -= cnt;
+	}
+
+	fo->file_size = MAX(fo->file_size, fo->offset + (int64_t)fo->len);
+
+	return TRUE;
+}
+
+int convert_flattened_format(char *infile, char *outfile)
+{
+	int result;
+	ulonglong segments;
+	struct flat_stream fs;
+	struct flat_output fo;
+	struct makedumpfile_header fh;
+	struct makedumpfile_data_header fdh;
+
+	BZERO(&fs, sizeof(fs));
+	BZERO(&fo, sizeof(fo));
+	result = FALSE;
+	segments = 0;
+
+	if (!infile || STREQ(infile, "-")) {
+		fs.fd = STDIN_FILENO;
+		fs.name = "(stdin)";
+	} else if ((fs.fd = open(infile, O_RDONLY)) < 0) {
+		error(INFO, "%s: %s\n", infile, strerror(errno));
+		return FALSE;
+	} else
+		fs.name = infile;
+
+	fs.buf = malloc(FLAT_CONVERT_BUFSIZE);
+	fo.buf = malloc(FLAT_CONVERT_BUFSIZE);
+	if (!fs.buf || !fo.buf) {
+		error(INFO, "cannot malloc conversion buffers\n");
+		goto out;
+	}
+
+	if (!flat_stream_read(&fs, &fh, sizeof(fh)))
+		goto out;
+	if (!is_bigendian()) {
+		fh.type = bswap_64(fh.type);
+		fh.version = bswap_64(fh.version);
+	}
+	if ((strncmp(fh.signature, MAKEDUMPFILE_SIGNATURE,
+	    sizeof(MAKEDUMPFILE_SIGNATURE)) != 0) ||
+	    (fh.type != TYPE_FLAT_HEADER)) {
+		error(INFO, "%s: not a makedumpfile flattened-format dumpfile\n",
+			fs.name);
+		goto out;
+	}
+	if (!flat_stream_read(&fs, NULL, MAX_SIZE_MDF_HEADER - sizeof(fh)))
+		goto out;
+
+	/*
+	 *  Never overwrite an existing file.
+	 */
+	fo.name = outfile;
+	if ((fo.fd = open(outfile, O_WRONLY|O_CREAT|O_EXCL, 0644)) < 0) {
+		error(INFO, "%s: %s\n", outfile, strerror(errno));
+		goto out;
+	}
+
+	while (TRUE) {
+		if (!flat_stream_read(&fs, &fdh, sizeof(fdh)))
+			break;
+		if (!is_bigendian()) {
+			fdh.offset = bswap_64(fdh.offset);
+			fdh.buf_size = bswap_64(fdh.buf_size);
+		}
+		if (fdh.offset == END_FLAG_FLAT_HEADER) {
+			result = TRUE;
+			break;
+		}
+		if ((fdh.offset < 0) || (fdh.buf_size < 0)) {
+			error(INFO, "%s: invalid data header at offset %lld (flat format)\n",
+				fs.name, fs.total - sizeof(fdh));
+			break;
+		}
+		if (!flat_convert_segment(&fs, &fo, fdh.offset, fdh.buf_size))
+			break;
+		segments++;
+	}
+
+	if (result && !flat_output_flush(&fo))
+		result = FALSE;
+	if (result && (ftruncate(fo.fd, (off_t)fo.file_size) < 0)) {
+		error(INFO, "%s: %s\n", outfile, strerror(errno));
+		result = FALSE;
+	}
+	if ((close(fo.fd) < 0) && result) {
+		error(INFO, "%s: %s\n", outfile, strerror(errno));
+		result = FALSE;
+	}
+
+	if (result)
+		fprintf(fp, "%s: %lld segments (%lld bytes) rearranged into %s (%lld bytes, %ld writes)\n",
+			fs.name, segments, fs.total, outfile,
+			(ulonglong)fo.file_size, fo.writes);
+	else
+		unlink(outfile);
+out:
+	if (fs.fd != STDIN_FILENO)
+		close(fs.fd);
+	free(fs.buf);
+	free(fo.buf);
+
+	return result;
 }
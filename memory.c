@@ -83,6 +83,9 @@ struct meminfo {		/* general purpose memory information structure */
 #define SEARCH_CHARS	(3)
 #define SEARCH_DEFAULT	(SEARCH_ULONG)
 
+#define SEARCH_FILTER_SHIFT (12)
+#define SEARCH_FILTER_BITS  (1 << SEARCH_FILTER_SHIFT)
+
 /* search mode information */
 struct searchinfo {
 	int mode;
@@ -126,6 +129,12 @@ struct searchinfo {
 			int started_flag;	/* string search needs history */
 		} s_chars;
 	} s_parms;
+	struct {
+		int ready;
+		int nfirst;		/* distinct first chars of the strings */
+		char first[256];
+		ulong bloom[SEARCH_FILTER_BITS / BITS_PER_LONG];
+	} filter;
 	char buf[BUFSIZE];
 };
 
@@ -1769,9 +1778,404 @@ int accessible(ulong kva)
 		return TRUE;							\
 	}
 
+/*
+ *  Generic physical page cache, in front of the pc->readmem function
+ *  of every dumpfile type.  On a miss, the whole page is read with the
+ *  dumpfile's own read function, which is the cache's fill function.
+ *  The cache is flushed whenever pc->readmem changes, and statistics
+ *  are kept for each fill function that has been used.  Reads that
+ *  cross a page boundary go straight to pc->readmem.  A fill that fails,
+ *  or that returns less than a page, is not cached; its result is handed
+ *  back to the caller as is, or READ_ERROR if it falls short of the bytes
+ *  that were asked for.  The diskdump, kvmdump and xendump readers keep
+ *  no physical page caches of their own, only what they need to decode
+ *  a page.
+ */
+#define DUMP_PAGE_CACHE_SIZE   (16*1024*1024)
+#define DUMP_PAGE_CACHE_FILLS  (4)
+
+static struct dump_page_cache {
+	ulong size;		/* requested size in bytes, or 0 if off */
+	int pages;
+	int hash_mask;
+	int *hash;
+	struct dump_page_cache_entry {
+		physaddr_t paddr;
+		char *bufptr;
+		int hash_next;	/* next entry in hash chain, or -1 */
+		int referenced;
+		int valid;
+	} *entries;
+	char *buf;
+	int evict_index;	/* CLOCK hand */
+	int (*fill)(int, void *, int, ulong, physaddr_t);
+	struct dump_page_cache_stats {
+		int (*fill)(int, void *, int, ulong, physaddr_t);
+		char *name;
+		ulong accesses;
+		ulong hits;
+		ulong fills;
+		ulong fill_errors;
+		ulong evictions;
+	} stats[DUMP_PAGE_CACHE_FILLS], *cur;
+} dump_page_cache = { DUMP_PAGE_CACHE_SIZE };
+
+#define DPC_HASH(paddr)  (((paddr) >> PAGESHIFT()) & dpc->hash_mask)
+
+static struct dump_page_cache *dpc = &dump_page_cache;
+
+/*
+ *  Discard all cached pages.
+ */
+void dump_page_cache_flush(void)
+{
+	int i;
+
+	if (!dpc->pages)
+		return;
+
+	for (i = 0; i < dpc->pages; i++) {
+		dpc->entries[i].valid = FALSE;
+		dpc->entries[i].hash_next = -1;
+	}
+	for (i = 0; i <= dpc->hash_mask; i++)
+		dpc->hash[i] = -1;
+	dpc->evict_index = 0;
+}
+
+/*
+ *  (Re-)allocate the cache for the current size and page size.
+ */
+static int dump_page_cache_alloc(void)
+{
+	int pages, buckets;
+	struct dump_page_cache_entry *entries;
+	int *hash;
+	char *buf;
+	int i;
+
+	free(dpc->entries);
+	free(dpc->hash);
+	free(dpc->buf);
+	dpc->entries = NULL;
+	dpc->hash = NULL;
+	dpc->buf = NULL;
+	dpc->pages = 0;
+	dpc->hash_mask = 0;
+
+	if (!dpc->size || !PAGESIZE())
+		return FALSE;
+
+	pages = MAX(dpc->size / PAGESIZE(), 1);
+	for (buckets = 1; buckets < pages; buckets <<= 1)
+		;
+
+	entries = calloc(pages, sizeof(struct dump_page_cache_entry));
+	hash = malloc(buckets * sizeof(int));
+	buf = malloc((size_t)pages * PAGESIZE());
+
+	if (!entries || !hash || !buf) {
+		free(entries);
+		free(hash);
+		free(buf);
+		error(INFO, "cannot malloc %d-page dumpfile page cache\n", pages);
+		dpc->size = 0;
+		return FALSE;
+	}
+
+	for (i = 0; i < pages; i++)
+		entries[i].bufptr = &buf[(size_t)i * PAGESIZE()];
+
+	dpc->entries = entries;
+	dpc->hash = hash;
+	dpc->buf = buf;
+	dpc->pages = pages;
+	dpc->hash_mask = buckets - 1;
+	dump_page_cache_flush();
+
+	return TRUE;
+}
+
+/*
+ *  Set the size of the page cache, either from the --page_cache
+ *  command line option or by "set page_cache".  A size of 0 or "off"
+ *  disables it.
+ */
+void set_dump_page_cache(char *arg)
+{
+	ulong size;
+	char *s;
+
+	if (STREQ(arg, "off"))
+		size = 0;
+	else {
+		s = strdup(arg);
+		if (!s || !calculate(s, &size, NULL, 0)) {
+			free(s);
+			error(FATAL, "invalid page_cache size: %s\n", arg);
+		}
+		free(s);
+	}
+
+	dpc->size = size;
+
+	if (dpc->pages || dpc->fill)
+		dump_page_cache_alloc();
+}
+
+ulong get_dump_page_cache(void)
+{
+	return dpc->size;
+}
+
+/*
+ *  Switch to a new fill function, keeping the statistics of up to
+ *  DUMP_PAGE_CACHE_FILLS of them.
+ */
+static void dump_page_cache_switch(void)
+{
+	int i;
+	struct dump_page_cache_stats *st;
+
+	dump_page_cache_flush();
+	dpc->fill = pc->readmem;
+
+	for (i = 0, st = NULL; i < DUMP_PAGE_CACHE_FILLS; i++) {
+		if (dpc->stats[i].fill == pc->readmem) {
+			st = &dpc->stats[i];
+			break;
+		}
+		if (!dpc->stats[i].fill) {
+			st = &dpc->stats[i];
+			st->fill = pc->readmem;
+			st->name = readmem_function_name();
+			break;
+		}
+	}
+	if (!st) {
+		st = &dpc->stats[DUMP_PAGE_CACHE_FILLS-1];
+		BZERO(st, sizeof(struct dump_page_cache_stats));
+		st->fill = pc->readmem;
+		st->name = readmem_function_name();
+	}
+	dpc->cur = st;
+}
+
+/*
+ *  Select an entry with the CLOCK algorithm.
+ */
+static int dump_page_cache_select(void)
+{
+	int i, *linkp;
+	struct dump_page_cache_entry *pce;
+
+	for (;;) {
+		i = dpc->evict_index;
+		dpc->evict_index = (i + 1) % dpc->pages;
+		pce = &dpc->entries[i];
+
+		if (!pce->valid)
+			break;
+		if (pce->referenced) {
+			pce->referenced = FALSE;
+			continue;
+		}
+
+		for (linkp = &dpc->hash[DPC_HASH(pce->paddr)]; *linkp >= 0;
+		     linkp = &dpc->entries[*linkp].hash_next) {
+			if (*linkp == i) {
+				*linkp = pce->hash_next;
+				break;
+			}
+		}
+		pce->valid = FALSE;
+		dpc->cur->evictions++;
+		break;
+	}
+
+	pce->hash_next = -1;
+	return i;
+}
+
+/*
+ *  Return TRUE if the page containing paddr is cached for the current
+ *  pc->readmem function, without counting it as an access.
+ */
+int dump_page_cache_present(physaddr_t paddr)
+{
+	int i;
+	physaddr_t pagebase;
+	struct dump_page_cache_entry *pce;
+
+	if (!dpc->pages || (dpc->fill != pc->readmem))
+		return FALSE;
+
+	pagebase = paddr - PAGEOFFSET(paddr);
+
+	for (i = dpc->hash[DPC_HASH(pagebase)]; i >= 0; i = pce->hash_next) {
+		pce = &dpc->entries[i];
+		if (pce->paddr == pagebase)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ *  Read through the page cache, with the same calling convention and
+ *  return values as the pc->readmem functions.  Once an unresolved
+ *  XENMACHADDR read has set XEN_MACHINE_ADDR, the dumpfile readers take
+ *  every address as a machine address for the rest of the command, so
+ *  the cache is neither consulted nor filled until it is cleared.
+ */
+int dump_page_cache_read(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
+{
+	int i, idx, retval;
+	physaddr_t pagebase;
+	struct dump_page_cache_entry *pce;
+
+	if (!dpc->size || !DUMPFILE() ||
+	    (pc->curcmd_flags & XEN_MACHINE_ADDR) ||
+	    ((PAGEOFFSET(paddr) + cnt) > PAGESIZE()))
+		return READMEM(fd, bufptr, cnt, addr, paddr);
+
+	if (!dpc->pages && !dump_page_cache_alloc())
+		return READMEM(fd, bufptr, cnt, addr, paddr);
+
+	if (dpc->fill != pc->readmem)
+		dump_page_cache_switch();
+
+	dpc->cur->accesses++;
+	pagebase = paddr - PAGEOFFSET(paddr);
+
+	for (i = dpc->hash[DPC_HASH(pagebase)]; i >= 0; i = pce->hash_next) {
+		pce = &dpc->entries[i];
+		if (pce->paddr == pagebase) {
+			pce->referenced = TRUE;
+			dpc->cur->hits++;
+			BCOPY(pce->bufptr + PAGEOFFSET(paddr), bufptr, cnt);
+			return cnt;
+		}
+	}
+
+	idx = dump_page_cache_select();
+	pce = &dpc->entries[idx];
+
+	retval = dpc->fill(fd, pce->bufptr, PAGESIZE(),
+		addr ? addr - PAGEOFFSET(paddr) : 0, pagebase);
+
+	if (retval != PAGESIZE()) {
+		dpc->cur->fill_errors++;
+		if (retval < 0)
+			return retval;
+		if (retval < (PAGEOFFSET(paddr) + cnt))
+			return READ_ERROR;
+		BCOPY(pce->bufptr + PAGEOFFSET(paddr), bufptr, cnt);
+		return cnt;
+	}
+
+	dpc->cur->fills++;
+	pce->paddr = pagebase;
+	pce->valid = TRUE;
+	pce->referenced = TRUE;
+	pce->hash_next = dpc->hash[DPC_HASH(pagebase)];
+	dpc->hash[DPC_HASH(pagebase)] = idx;
+
+	BCOPY(pce->bufptr + PAGEOFFSET(paddr), bufptr, cnt);
+
+	return cnt;
+}
+
+void dump_page_cache_dump(FILE *ofp)
+{
+	int i;
+	struct dump_page_cache_stats *st;
+
+	fprintf(ofp, "\ndump_page_cache:\n");
+	fprintf(ofp, "         size: %ld%s\n", dpc->size, dpc->size ? "" : " (off)");
+	fprintf(ofp, "        pages: %d\n", dpc->pages);
+	fprintf(ofp, "    hash_mask: %x\n", dpc->hash_mask);
+	fprintf(ofp, "  evict_index: %d\n", dpc->evict_index);
+	fprintf(ofp, "         fill: %s\n", dpc->cur && (dpc->fill == dpc->cur->fill) &&
+		dpc->cur->name ? dpc->cur->name : "(none)");
+
+	for (i = 0; i < DUMP_PAGE_CACHE_FILLS; i++) {
+		st = &dpc->stats[i];
+		if (!st->fill)
+			break;
+		fprintf(ofp, "     stats[%d]: %s()\n", i, st->name ? st->name : "(unknown)");
+		fprintf(ofp, "               accesses: %ld\n", st->accesses);
+		fprintf(ofp, "                   hits: %ld ", st->hits);
+		if (st->accesses)
+			fprintf(ofp, "(%ld%%)\n", st->hits * 100 / st->accesses);
+		else
+			fprintf(ofp, "\n");
+		fprintf(ofp, "                  fills: %ld\n", st->fills);
+		fprintf(ofp, "            fill_errors: %ld\n", st->fill_errors);
+		fprintf(ofp, "              evictions: %ld\n", st->evictions);
+	}
+}
+
+/*
+ *  Return how many of the size bytes at addr, which has just been
+ *  translated to paddr, can be read with one pc->readmem call.  The
+ *  run extends across pages for as long as they are physically
+ *  contiguous, using the extent of a large-page or unity mapping as
+ *  reported by the translation, and is bounded by what the dumpfile
+ *  can read in one call.
+ */
+static long readmem_run(ulonglong addr, int memtype, physaddr_t paddr, long size)
+{
+	long cnt, limit;
+	ulonglong next;
+	physaddr_t next_paddr;
+	int found;
+
+	cnt = PAGESIZE() - PAGEOFFSET(paddr);
+
+	if (cnt >= size)
+		return size;
+
+	if (!(pc->flags & (NETDUMP|KDUMP)) ||
+	    ((limit = netdump_contiguous(paddr, size)) <= cnt))
+		return cnt;
+
+	switch (memtype) {
+	case PHYSADDR:
+		return limit;
+
+	case KVADDR:
+		if (vt->vtop_extent > cnt)
+			cnt = vt->vtop_extent;
+		break;
+
+	case UVADDR:
+		break;
+
+	default:
+		return cnt;
+	}
+
+	while (cnt < limit) {
+		next = addr + cnt;
+
+		if (memtype == KVADDR)
+			found = kvtop(CURRENT_CONTEXT(), next, &next_paddr, 0);
+		else
+			found = uvtop(CURRENT_CONTEXT(), next, &next_paddr, 0);
+
+		if (!found || (next_paddr != (paddr + cnt)))
+			break;
+
+		cnt += MAX(vt->vtop_extent, PAGESIZE() - PAGEOFFSET(next_paddr));
+	}
+
+	return MIN(cnt, limit);
+}
+
 int readmem(ulonglong addr, int memtype, void *buffer, long size, char *type, ulong error_handle)
 {
-	int fd;
+	int fd, retval, pagewise;
 	long cnt, orig_size;
 	physaddr_t paddr;
 	ulonglong pseudo;
@@ -1784,6 +2188,7 @@ int readmem(ulonglong addr, int memtype, void *buffer, long size, char *type, ul
 
 	bufptr = (char *)buffer;
 	orig_size = size;
+	pagewise = FALSE;
 
 	if (size <= 0) {
 		if (PRINT_ERROR_MESSAGE)
@@ -1864,12 +2269,19 @@ int readmem(ulonglong addr, int memtype, void *buffer, long size, char *type, ul
 		}
 
 		/*
-		 *  Compute bytes till end of page.
+		 *  Compute bytes till end of page.  Reads from ELF dumpfiles
+		 *  may continue past it for as long as the pages are
+		 *  contiguous, both physically and in the file.  If such a
+		 *  read fails, it is retried a page at a time so that errors
+		 *  and partial reads are reported for the failing page.
 		 */
 		cnt = PAGESIZE() - PAGEOFFSET(paddr);
 
 		if (cnt > size)
 			cnt = size;
+		else if (!pagewise)
+			cnt = readmem_run(addr, memtype, paddr, size);
+		pagewise = FALSE;
 
 		if (CRASHDEBUG(4))
 			fprintf(fp, "<%s: addr: %llx paddr: %llx cnt: %ld>\n",
@@ -1880,8 +2292,18 @@ int readmem(ulonglong addr, int memtype, void *buffer, long size, char *type, ul
 		else
 			pc->curcmd_flags &= ~MEMTYPE_KVADDR;
 
-		switch (READMEM(fd, bufptr, cnt, (memtype == PHYSADDR)
-				|| (memtype == XENMACHADDR) ? 0 : addr, paddr)) {
+		if (memtype == XENMACHADDR)
+			retval = READMEM(fd, bufptr, cnt, 0, paddr);
+		else
+			retval = dump_page_cache_read(fd, bufptr, cnt,
+				memtype == PHYSADDR ? 0 : addr, paddr);
+
+		if ((retval < 0) && (cnt > (PAGESIZE() - PAGEOFFSET(paddr)))) {
+			pagewise = TRUE;
+			continue;
+		}
+
+		switch (retval) {
 		case SEEK_ERROR:
 			if (PRINT_ERROR_MESSAGE)
 				error(INFO, SEEK_ERRMSG, memtype_string(memtype, 0), addr, type);
@@ -2397,6 +2819,9 @@ int writemem(ulonglong addr, int memtype, void *buffer, long size, char *type, u
 		if (cnt > size)
 			cnt = size;
 
+		dump_page_cache_flush();
+		vtop_cache_flush();
+
 		switch (pc->writemem(fd, bufptr, cnt, addr, paddr)) {
 		case SEEK_ERROR:
 			if (PRINT_ERROR_MESSAGE)
@@ -2517,6 +2942,139 @@ static int generic_write_dumpfile(ulonglong addr, void *buffer, long size, char
 	return retval;
 }
 
+/*
+ *  Software TLB for the quiet kvtop() and uvtop() translations.  Entries
+ *  are keyed by address space -- 0 for the kernel, or the mm_struct of
+ *  a user translation -- and virtual page number.  Translations that
+ *  report a large-page or unity-mapped extent are kept in a second
+ *  table keyed by 2MB frame, as a [start, end) range that is known to
+ *  be physically contiguous.  Failed and verbose translations are not
+ *  cached, nor is anything cached until the session is initialized,
+ *  since translations may change while it is.  The cache is flushed
+ *  along with the machdep page table caches on a live system, and
+ *  whenever memory is written.
+ */
+#define VTOP_CACHE_ENTRIES  (4096)
+#define VTOP_LARGE_ENTRIES  (512)
+#define VTOP_LARGE_SHIFT    (21)
+
+#define VTOP_KERNEL         (0UL)
+
+#define VTOP_CACHED(verbose) (!(verbose) && (pc->flags & RUNTIME))
+
+static struct vtop_cache {
+	struct vtop_cache_entry {
+		ulong asid;
+		ulong vpn;
+		physaddr_t paddr;	/* of the page */
+		int valid;
+	} entries[VTOP_CACHE_ENTRIES];
+	struct vtop_large_entry {
+		ulong asid;
+		ulong start;
+		ulong end;
+		physaddr_t paddr;	/* of start */
+		int valid;
+	} large[VTOP_LARGE_ENTRIES];
+	ulong hits;
+	ulong large_hits;
+	ulong misses;
+	ulong flushes;
+} vtop_cache = { 0 };
+
+#define VTOP_HASH(asid, vpn) \
+	((((asid) >> 6) ^ (vpn)) & (VTOP_CACHE_ENTRIES-1))
+#define VTOP_LARGE_HASH(asid, vaddr) \
+	((((asid) >> 6) ^ ((vaddr) >> VTOP_LARGE_SHIFT)) & (VTOP_LARGE_ENTRIES-1))
+
+void vtop_cache_flush(void)
+{
+	BZERO(vtop_cache.entries, sizeof(vtop_cache.entries));
+	BZERO(vtop_cache.large, sizeof(vtop_cache.large));
+	vtop_cache.flushes++;
+}
+
+static int vtop_cache_lookup(ulong asid, ulong vaddr, physaddr_t *paddr)
+{
+	struct vtop_cache_entry *vce;
+	struct vtop_large_entry *vle;
+	ulong vpn;
+
+	vpn = vaddr >> PAGESHIFT();
+
+	vce = &vtop_cache.entries[VTOP_HASH(asid, vpn)];
+	if (vce->valid && (vce->asid == asid) && (vce->vpn == vpn)) {
+		*paddr = vce->paddr + PAGEOFFSET(vaddr);
+		vt->vtop_extent = 0;
+		vtop_cache.hits++;
+		return TRUE;
+	}
+
+	vle = &vtop_cache.large[VTOP_LARGE_HASH(asid, vaddr)];
+	if (vle->valid && (vle->asid == asid) &&
+	    (vaddr >= vle->start) && (vaddr < vle->end)) {
+		*paddr = vle->paddr + (vaddr - vle->start);
+		vt->vtop_extent = vle->end - vaddr;
+		vtop_cache.large_hits++;
+		return TRUE;
+	}
+
+	vtop_cache.misses++;
+	return FALSE;
+}
+
+static void vtop_cache_store(ulong asid, ulong vaddr, physaddr_t paddr)
+{
+	struct vtop_cache_entry *vce;
+	struct vtop_large_entry *vle;
+	ulong start, end;
+
+	start = PAGEBASE(vaddr);
+
+	if (vt->vtop_extent > (PAGESIZE() - PAGEOFFSET(vaddr))) {
+		end = vaddr + vt->vtop_extent;
+		if ((end > vaddr) &&
+		    ((start >> VTOP_LARGE_SHIFT) == ((end - 1) >> VTOP_LARGE_SHIFT))) {
+			vle = &vtop_cache.large[VTOP_LARGE_HASH(asid, vaddr)];
+			if (vle->valid && (vle->asid == asid) &&
+			    (vle->start <= start) && (vle->end == end))
+				return;
+			vle->asid = asid;
+			vle->start = start;
+			vle->end = end;
+			vle->paddr = paddr - PAGEOFFSET(vaddr);
+			vle->valid = TRUE;
+			return;
+		}
+	}
+
+	vce = &vtop_cache.entries[VTOP_HASH(asid, start >> PAGESHIFT())];
+	vce->asid = asid;
+	vce->vpn = start >> PAGESHIFT();
+	vce->paddr = paddr - PAGEOFFSET(vaddr);
+	vce->valid = TRUE;
+}
+
+void dump_vtop_cache(FILE *ofp)
+{
+	ulong lookups;
+
+	lookups = vtop_cache.hits + vtop_cache.large_hits + vtop_cache.misses;
+
+	fprintf(ofp, "\nvtop_cache:\n");
+	fprintf(ofp, "       entries: %d\n", VTOP_CACHE_ENTRIES);
+	fprintf(ofp, " large_entries: %d\n", VTOP_LARGE_ENTRIES);
+	fprintf(ofp, "          hits: %ld\n", vtop_cache.hits);
+	fprintf(ofp, "    large_hits: %ld\n", vtop_cache.large_hits);
+	fprintf(ofp, "        misses: %ld ", vtop_cache.misses);
+	if (lookups)
+		fprintf(ofp, "(%ld%% hit rate)\n",
+			(lookups - vtop_cache.misses) * 100 / lookups);
+	else
+		fprintf(ofp, "\n");
+	fprintf(ofp, "       flushes: %ld\n", vtop_cache.flushes);
+}
+
 /*
  *  Translates a kernel virtual address to its physical address.  cmd_vtop()
  *  sets the verbose flag so that the pte translation gets displayed; all
@@ -2525,8 +3083,22 @@ static int generic_write_dumpfile(ulonglong addr, void *buffer, long size, char
 int kvtop(struct task_context *tc, ulong kvaddr, physaddr_t * paddr, int verbose)
 {
 	physaddr_t unused;
+	int retval;
+
+	vt->vtop_extent = 0;
 
-	return (machdep->kvtop(tc ? tc : CURRENT_CONTEXT(), kvaddr, paddr ? paddr : &unused, verbose));
+	if (!paddr)
+		paddr = &unused;
+
+	if (VTOP_CACHED(verbose) && vtop_cache_lookup(VTOP_KERNEL, kvaddr, paddr))
+		return TRUE;
+
+	retval = machdep->kvtop(tc ? tc : CURRENT_CONTEXT(), kvaddr, paddr, verbose);
+
+	if (retval && VTOP_CACHED(verbose))
+		vtop_cache_store(VTOP_KERNEL, kvaddr, *paddr);
+
+	return retval;
 }
 
 /*
@@ -2540,7 +3112,22 @@ int kvtop(struct task_context *tc, ulong kvaddr, physaddr_t * paddr, int verbose
  */
 int uvtop(struct task_context *tc, ulong vaddr, physaddr_t * paddr, int verbose)
 {
-	return (machdep->uvtop(tc, vaddr, paddr, verbose));
+	ulong asid;
+	int retval;
+
+	vt->vtop_extent = 0;
+
+	asid = tc ? tc->mm_struct : 0;
+
+	if (VTOP_CACHED(verbose) && asid && vtop_cache_lookup(asid, vaddr, paddr))
+		return TRUE;
+
+	retval = machdep->uvtop(tc, vaddr, paddr, verbose);
+
+	if (retval && VTOP_CACHED(verbose) && asid)
+		vtop_cache_store(asid, vaddr, *paddr);
+
+	return retval;
 }
 
 /*
@@ -11524,54 +12111,237 @@ static void display_with_pre_and_post(void *bufptr, ulonglong addr, struct searc
 	fprintf(fp, "\n");
 }
 
+/*
+ *  Prefilters that let the search functions skip quickly over words
+ *  and bytes that cannot match.  A single value is compared against
+ *  four words at a time; for more values, a word is only compared
+ *  against each of them if its masked value hits a bit in a small
+ *  Bloom filter built from the values.  String searches skip to the
+ *  next byte that begins one of the targets, using memchr() if there
+ *  is only one.
+ */
+#define SEARCH_HASH(X) \
+	((ulong)(((ulonglong)(X) * 0x9e3779b97f4a7c15ULL) >> (64 - SEARCH_FILTER_SHIFT)))
+#define SEARCH_FILTER_SET(si, X) \
+	((si)->filter.bloom[SEARCH_HASH(X) / BITS_PER_LONG] |= \
+		(1UL << (SEARCH_HASH(X) % BITS_PER_LONG)))
+#define SEARCH_FILTER_HIT(si, X) \
+	((si)->filter.bloom[SEARCH_HASH(X) / BITS_PER_LONG] & \
+		(1UL << (SEARCH_HASH(X) % BITS_PER_LONG)))
+
+static void search_filter_init(struct searchinfo *si)
+{
+	int i;
+	unsigned char c;
+
+	BZERO(&si->filter, sizeof(si->filter));
+
+	for (i = 0; i < si->vcnt; i++) {
+		switch (si->mode) {
+		case SEARCH_ULONG:
+			SEARCH_FILTER_SET(si, si->s_parms.s_ulong.value[i] |
+				si->s_parms.s_ulong.mask);
+			break;
+		case SEARCH_UINT:
+			SEARCH_FILTER_SET(si, (uint)(si->s_parms.s_uint.value[i] |
+				si->s_parms.s_uint.mask));
+			break;
+		case SEARCH_USHORT:
+			SEARCH_FILTER_SET(si, (ushort)(si->s_parms.s_ushort.value[i] |
+				si->s_parms.s_ushort.mask));
+			break;
+		case SEARCH_CHARS:
+			if (si->s_parms.s_chars.len[i] <= 0) {
+				memset(si->filter.first, 1, sizeof(si->filter.first));
+				si->filter.nfirst = 2;
+				break;
+			}
+			c = si->s_parms.s_chars.value[i][0];
+			if (!si->filter.first[c]) {
+				si->filter.first[c] = 1;
+				si->filter.nfirst++;
+			}
+			break;
+		}
+	}
+
+	si->filter.ready = TRUE;
+}
+
+/*
+ *  Return the index of the next ulong, starting with index i, that
+ *  may match one of the search values, or cnt if there is none.
+ */
+static int search_ulong_next(ulong *ptr, int i, int cnt, struct searchinfo *si)
+{
+	ulong mask = si->s_parms.s_ulong.mask;
+	ulong v;
+
+	if (si->vcnt == 1) {
+		v = SEARCHMASK(si->s_parms.s_ulong.value[0]);
+		for ( ; (i + 4) <= cnt; i += 4) {
+			if ((SEARCHMASK(ptr[i]) == v) | (SEARCHMASK(ptr[i+1]) == v) |
+			    (SEARCHMASK(ptr[i+2]) == v) | (SEARCHMASK(ptr[i+3]) == v))
+				break;
+		}
+		for ( ; i < cnt; i++) {
+			if (SEARCHMASK(ptr[i]) == v)
+				return i;
+		}
+		return cnt;
+	}
+
+	for ( ; i < cnt; i++) {
+		if (SEARCH_FILTER_HIT(si, SEARCHMASK(ptr[i])))
+			return i;
+	}
+	return cnt;
+}
+
+static int search_uint_next(uint *ptr, int i, int cnt, struct searchinfo *si)
+{
+	uint mask = si->s_parms.s_uint.mask;
+	uint v;
+
+	if (si->vcnt == 1) {
+		v = SEARCHMASK(si->s_parms.s_uint.value[0]);
+		for ( ; (i + 4) <= cnt; i += 4) {
+			if ((SEARCHMASK(ptr[i]) == v) | (SEARCHMASK(ptr[i+1]) == v) |
+			    (SEARCHMASK(ptr[i+2]) == v) | (SEARCHMASK(ptr[i+3]) == v))
+				break;
+		}
+		for ( ; i < cnt; i++) {
+			if (SEARCHMASK(ptr[i]) == v)
+				return i;
+		}
+		return cnt;
+	}
+
+	for ( ; i < cnt; i++) {
+		if (SEARCH_FILTER_HIT(si, (uint)SEARCHMASK(ptr[i])))
+			return i;
+	}
+	return cnt;
+}
+
+static int search_ushort_next(ushort *ptr, int i, int cnt, struct searchinfo *si)
+{
+	ushort mask = si->s_parms.s_ushort.mask;
+	ushort v;
+
+	if (si->vcnt == 1) {
+		v = SEARCHMASK(si->s_parms.s_ushort.value[0]);
+		for ( ; (i + 4) <= cnt; i += 4) {
+			if (((ushort)SEARCHMASK(ptr[i]) == v) |
+			    ((ushort)SEARCHMASK(ptr[i+1]) == v) |
+			    ((ushort)SEARCHMASK(ptr[i+2]) == v) |
+			    ((ushort)SEARCHMASK(ptr[i+3]) == v))
+				break;
+		}
+		for ( ; i < cnt; i++) {
+			if ((ushort)SEARCHMASK(ptr[i]) == v)
+				return i;
+		}
+		return cnt;
+	}
+
+	for ( ; i < cnt; i++) {
+		if (SEARCH_FILTER_HIT(si, (ushort)SEARCHMASK(ptr[i])))
+			return i;
+	}
+	return cnt;
+}
+
+/*
+ *  Return the index of the next byte, starting with index i, that
+ *  begins one of the search strings, or cnt if there is none.
+ */
+static int search_chars_next(char *ptr, int i, int cnt, struct searchinfo *si)
+{
+	char *p;
+
+	if (si->filter.nfirst == 1) {
+		p = memchr(&ptr[i], si->s_parms.s_chars.value[0][0], cnt - i);
+		return p ? p - ptr : cnt;
+	}
+
+	for ( ; i < cnt; i++) {
+		if (si->filter.first[(unsigned char)ptr[i]])
+			return i;
+	}
+	return cnt;
+}
+
 static ulong search_ulong(ulong * bufptr, ulong addr, int longcnt, struct searchinfo *si)
 {
 	int i;
+	ulong *ptr;
 	ulong mask = si->s_parms.s_ulong.mask;
-	for (i = 0; i < longcnt; i++, bufptr++, addr += sizeof(long)) {
+
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_ulong_next(bufptr, 0, longcnt, si); i < longcnt;
+	     i = search_ulong_next(bufptr, i + 1, longcnt, si)) {
+		ptr = &bufptr[i];
 		for (si->val = 0; si->val < si->vcnt; si->val++) {
-			if (SEARCHMASK(*bufptr) == SEARCHMASK(si->s_parms.s_ulong.value[si->val])) {
+			if (SEARCHMASK(*ptr) == SEARCHMASK(si->s_parms.s_ulong.value[si->val])) {
 				if (si->do_task_header) {
 					print_task_header(fp, si->task_context, si->tasks_found);
 					si->do_task_header = FALSE;
 					si->tasks_found++;
 				}
 				if (si->context)
-					display_with_pre_and_post(bufptr, addr, si);
+					display_with_pre_and_post(ptr, addr + i * sizeof(long), si);
 				else
-					fprintf(fp, "%lx: %lx %s\n", addr, *bufptr, show_opt_string(si));
+					fprintf(fp, "%lx: %lx %s\n", addr + i * sizeof(long),
+						*ptr, show_opt_string(si));
 			}
 		}
 	}
-	return addr;
+	return addr + longcnt * sizeof(long);
 }
 
 /* phys search uses ulonglong address representation */
 static ulonglong search_ulong_p(ulong * bufptr, ulonglong addr, int longcnt, struct searchinfo *si)
 {
 	int i;
+	ulong *ptr;
 	ulong mask = si->s_parms.s_ulong.mask;
-	for (i = 0; i < longcnt; i++, bufptr++, addr += sizeof(long)) {
+
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_ulong_next(bufptr, 0, longcnt, si); i < longcnt;
+	     i = search_ulong_next(bufptr, i + 1, longcnt, si)) {
+		ptr = &bufptr[i];
 		for (si->val = 0; si->val < si->vcnt; si->val++) {
-			if (SEARCHMASK(*bufptr) == SEARCHMASK(si->s_parms.s_ulong.value[si->val])) {
+			if (SEARCHMASK(*ptr) == SEARCHMASK(si->s_parms.s_ulong.value[si->val])) {
 				if (si->context)
-					display_with_pre_and_post(bufptr, addr, si);
+					display_with_pre_and_post(ptr, addr + i * sizeof(long), si);
 				else
-					fprintf(fp, "%llx: %lx %s\n", addr, *bufptr, show_opt_string(si));
+					fprintf(fp, "%llx: %lx %s\n", addr + i * sizeof(long),
+						*ptr, show_opt_string(si));
 			}
 		}
 	}
-	return addr;
+	return addr + longcnt * sizeof(long);
 }
 
 static ulong search_uint(ulong * bufptr, ulong addr, int longcnt, struct searchinfo *si)
 {
 	int i;
 	int cnt = longcnt * (sizeof(long) / sizeof(int));
-	uint *ptr = (uint *) bufptr;
+	uint *base = (uint *) bufptr;
+	uint *ptr;
 	uint mask = si->s_parms.s_uint.mask;
 
-	for (i = 0; i < cnt; i++, ptr++, addr += sizeof(int)) {
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_uint_next(base, 0, cnt, si); i < cnt;
+	     i = search_uint_next(base, i + 1, cnt, si)) {
+		ptr = &base[i];
 		for (si->val = 0; si->val < si->vcnt; si->val++) {
 			if (SEARCHMASK(*ptr) == SEARCHMASK(si->s_parms.s_uint.value[si->val])) {
 				if (si->do_task_header) {
@@ -11580,13 +12350,14 @@ static ulong search_uint(ulong * bufptr, ulong addr, int longcnt, struct searchi
 					si->tasks_found++;
 				}
 				if (si->context)
-					display_with_pre_and_post(ptr, addr, si);
+					display_with_pre_and_post(ptr, addr + i * sizeof(int), si);
 				else
-					fprintf(fp, "%lx: %x %s\n", addr, *ptr, show_opt_string(si));
+					fprintf(fp, "%lx: %x %s\n", addr + i * sizeof(int),
+						*ptr, show_opt_string(si));
 			}
 		}
 	}
-	return addr;
+	return addr + cnt * sizeof(int);
 }
 
 /* phys search uses ulonglong address representation */
@@ -11594,30 +12365,43 @@ static ulonglong search_uint_p(ulong * bufptr, ulonglong addr, int longcnt, stru
 {
 	int i;
 	int cnt = longcnt * (sizeof(long) / sizeof(int));
-	uint *ptr = (uint *) bufptr;
+	uint *base = (uint *) bufptr;
+	uint *ptr;
 	uint mask = si->s_parms.s_uint.mask;
 
-	for (i = 0; i < cnt; i++, ptr++, addr += sizeof(int)) {
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_uint_next(base, 0, cnt, si); i < cnt;
+	     i = search_uint_next(base, i + 1, cnt, si)) {
+		ptr = &base[i];
 		for (si->val = 0; si->val < si->vcnt; si->val++) {
 			if (SEARCHMASK(*ptr) == SEARCHMASK(si->s_parms.s_uint.value[si->val])) {
 				if (si->context)
-					display_with_pre_and_post(ptr, addr, si);
+					display_with_pre_and_post(ptr, addr + i * sizeof(int), si);
 				else
-					fprintf(fp, "%llx: %x %s\n", addr, *ptr, show_opt_string(si));
+					fprintf(fp, "%llx: %x %s\n", addr + i * sizeof(int),
+						*ptr, show_opt_string(si));
 			}
 		}
 	}
-	return addr;
+	return addr + cnt * sizeof(int);
 }
 
 static ulong search_ushort(ulong * bufptr, ulong addr, int longcnt, struct searchinfo *si)
 {
 	int i;
 	int cnt = longcnt * (sizeof(long) / sizeof(short));
-	ushort *ptr = (ushort *) bufptr;
+	ushort *base = (ushort *) bufptr;
+	ushort *ptr;
 	ushort mask = si->s_parms.s_ushort.mask;
 
-	for (i = 0; i < cnt; i++, ptr++, addr += sizeof(short)) {
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_ushort_next(base, 0, cnt, si); i < cnt;
+	     i = search_ushort_next(base, i + 1, cnt, si)) {
+		ptr = &base[i];
 		for (si->val = 0; si->val < si->vcnt; si->val++) {
 			if (SEARCHMASK(*ptr) == SEARCHMASK(si->s_parms.s_ushort.value[si->val])) {
 				if (si->do_task_header) {
@@ -11626,13 +12410,14 @@ static ulong search_ushort(ulong * bufptr, ulong addr, int longcnt, struct searc
 					si->tasks_found++;
 				}
 				if (si->context)
-					display_with_pre_and_post(ptr, addr, si);
+					display_with_pre_and_post(ptr, addr + i * sizeof(short), si);
 				else
-					fprintf(fp, "%lx: %x %s\n", addr, *ptr, show_opt_string(si));
+					fprintf(fp, "%lx: %x %s\n", addr + i * sizeof(short),
+						*ptr, show_opt_string(si));
 			}
 		}
 	}
-	return addr;
+	return addr + cnt * sizeof(short);
 }
 
 /* phys search uses ulonglong address representation */
@@ -11640,20 +12425,27 @@ static ulonglong search_ushort_p(ulong * bufptr, ulonglong addr, int longcnt, st
 {
 	int i;
 	int cnt = longcnt * (sizeof(long) / sizeof(short));
-	ushort *ptr = (ushort *) bufptr;
+	ushort *base = (ushort *) bufptr;
+	ushort *ptr;
 	ushort mask = si->s_parms.s_ushort.mask;
 
-	for (i = 0; i < cnt; i++, ptr++, addr += sizeof(short)) {
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_ushort_next(base, 0, cnt, si); i < cnt;
+	     i = search_ushort_next(base, i + 1, cnt, si)) {
+		ptr = &base[i];
 		for (si->val = 0; si->val < si->vcnt; si->val++) {
 			if (SEARCHMASK(*ptr) == SEARCHMASK(si->s_parms.s_ushort.value[si->val])) {
 				if (si->context)
-					display_with_pre_and_post(ptr, addr, si);
+					display_with_pre_and_post(ptr, addr + i * sizeof(short), si);
 				else
-					fprintf(fp, "%llx: %x %s\n", addr, *ptr, show_opt_string(si));
+					fprintf(fp, "%llx: %x %s\n", addr + i * sizeof(short),
+						*ptr, show_opt_string(si));
 			}
 		}
 	}
-	return addr;
+	return addr + cnt * sizeof(short);
 }
 
 /*
@@ -11709,7 +12501,9 @@ static ulong search_chars(ulong * bufptr, ulong addr, int longcnt, struct search
 	int len;
 	char *target;
 	int charcnt = longcnt * sizeof(long);
-	char *ptr = (char *)bufptr;
+	char *base = (char *)bufptr;
+	char *ptr = base;
+	ulong start = addr;
 
 	/* is this the first page of this search? */
 	if (si->s_parms.s_chars.started_flag == 0) {
@@ -11746,7 +12540,13 @@ static ulong search_chars(ulong * bufptr, ulong addr, int longcnt, struct search
 			cross[j].hit[i] = 0;
 	}
 
-	for (i = 0; i < charcnt; i++, ptr++, addr++) {
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_chars_next(base, 0, charcnt, si); i < charcnt;
+	     i = search_chars_next(base, i + 1, charcnt, si)) {
+		ptr = &base[i];
+		addr = start + i;
 		for (j = 0; j < si->vcnt; j++) {
 			target = si->s_parms.s_chars.value[j];
 			len = si->s_parms.s_chars.len[j];
@@ -11766,7 +12566,7 @@ static ulong search_chars(ulong * bufptr, ulong addr, int longcnt, struct search
 			}
 		}
 	}
-	return addr;
+	return start + charcnt;
 }
 
 static void report_match_p(ulonglong addr, char *ptr1, int len1, char *ptr2, int len2)
@@ -11794,7 +12594,9 @@ static ulonglong search_chars_p(ulong * bufptr, ulonglong addr_p, int longcnt, s
 	int len;
 	char *target;
 	int charcnt = longcnt * sizeof(long);
-	char *ptr = (char *)bufptr;
+	char *base = (char *)bufptr;
+	char *ptr = base;
+	ulonglong start = addr_p;
 
 	/* is this the first page of this search? */
 	if (si->s_parms.s_chars.started_flag == 0) {
@@ -11830,7 +12632,13 @@ static ulonglong search_chars_p(ulong * bufptr, ulonglong addr_p, int longcnt, s
 			cross[j].hit[i] = 0;
 	}
 
-	for (i = 0; i < charcnt; i++, ptr++, addr_p++) {
+	if (!si->filter.ready)
+		search_filter_init(si);
+
+	for (i = search_chars_next(base, 0, charcnt, si); i < charcnt;
+	     i = search_chars_next(base, i + 1, charcnt, si)) {
+		ptr = &base[i];
+		addr_p = start + i;
 		for (j = 0; j < si->vcnt; j++) {
 			target = si->s_parms.s_chars.value[j];
 			len = si->s_parms.s_chars.len[j];
@@ -11850,7 +12658,7 @@ static ulonglong search_chars_p(ulong * bufptr, ulonglong addr_p, int longcnt, s
 			}
 		}
 	}
-	return addr_p;
+	return start + charcnt;
 }
 
 static void search_virtual(struct searchinfo *si)
@@ -11977,7 +12785,7 @@ static void search_physical(struct searchinfo *si)
 	ulong *ubp;
 	int wordcnt, lastpage;
 	ulonglong pnext, ppp;
-	char *pagebuf;
+	char *pagebuf, *pageptr;
 	ulong pct, pages_read, pages_checked;
 	time_t begin, finish;
 	ulong page;
@@ -12006,15 +12814,22 @@ static void search_physical(struct searchinfo *si)
 		if (LKCD_DUMPFILE())
 			set_lkcd_nohash();
 
+		/*
+		 *  ELF dumpfiles mapped with --mmap_dump are searched in place.
+		 */
+		if (!(pageptr = netdump_mmap_ptr(ppp, PAGESIZE())))
+			pageptr = pagebuf;
+
 		if (!phys_to_page(ppp, &page) ||
-		    !readmem(ppp, PHYSADDR, pagebuf, PAGESIZE(), "search page", RETURN_ON_ERROR | QUIET)) {
+		    ((pageptr == pagebuf) &&
+		     !readmem(ppp, PHYSADDR, pagebuf, PAGESIZE(), "search page", RETURN_ON_ERROR | QUIET))) {
 			if (!next_physpage(ppp, &ppp))
 				break;
 			continue;
 		}
 
 		pages_read++;
-		ubp = (ulong *) & pagebuf[pnext - ppp];
+		ubp = (ulong *) & pageptr[pnext - ppp];
 		if (lastpage) {
 			if (end_in == (ulonglong) (-1))
 				wordcnt = PAGESIZE() / sizeof(long);
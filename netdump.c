@@ -42,6 +42,10 @@ static void get_netdump_regs_arm(struct bt_info *, ulong *, ulong *);
 static void get_netdump_regs_arm64(struct bt_info *, ulong *, ulong *);
 static physaddr_t xen_kdump_p2m(physaddr_t);
 static void check_dumpfile_size(char *);
+static void pt_load_index_init(void);
+static struct pt_load_segment *pt_load_lookup(physaddr_t);
+static long netdump_file_extent(physaddr_t, off_t *);
+static void netdump_mmap_init(void);
 static int proc_kcore_init_32(FILE * fp);
 static int proc_kcore_init_64(FILE * fp);
 static char *get_regs_from_note(char *, ulong *, ulong *);
@@ -370,6 +374,8 @@ int is_netdump(char *file, ulong source_query)
 		break;
 	}
 
+	pt_load_index_init();
+
 	if (CRASHDEBUG(1))
 		netdump_memory_dump(fp);
 
@@ -463,6 +469,111 @@ static void check_dumpfile_size(char *file)
 	}
 }
 
+static int compare_pt_load(const void *v1, const void *v2)
+{
+	struct pt_load_segment *p1, *p2;
+
+	p1 = *(struct pt_load_segment **)v1;
+	p2 = *(struct pt_load_segment **)v2;
+
+	if (p1->phys_start < p2->phys_start)
+		return -1;
+	return p1->phys_start > p2->phys_start ? 1 : 0;
+}
+
+/*
+ *  The physical end of a PT_LOAD segment, including any zero-filled
+ *  p_memsz beyond its p_filesz.
+ */
+#define PT_LOAD_END(pls)  ((pls)->zero_fill ? (pls)->zero_fill : (pls)->phys_end)
+
+/*
+ *  Build an index of the PT_LOAD segments sorted by physical address, so
+ *  that pt_load_lookup() can do a binary search.  If any segments overlap,
+ *  their ELF order determines which one is used, so the index is not
+ *  built and the segments are searched linearly.
+ */
+static void pt_load_index_init(void)
+{
+	int i;
+	struct pt_load_segment **index;
+
+	if (nd->num_pt_load_segments < 2)
+		return;
+
+	if ((index = malloc(nd->num_pt_load_segments * sizeof(struct pt_load_segment *))) == NULL)
+		return;
+
+	for (i = 0; i < nd->num_pt_load_segments; i++)
+		index[i] = &nd->pt_load_segments[i];
+
+	qsort(index, nd->num_pt_load_segments, sizeof(struct pt_load_segment *), compare_pt_load);
+
+	for (i = 1; i < nd->num_pt_load_segments; i++) {
+		if (index[i]->phys_start < PT_LOAD_END(index[i - 1])) {
+			if (CRASHDEBUG(1))
+				error(INFO, "overlapping PT_LOAD segments: %llx-%llx %llx-%llx\n",
+				      (ulonglong) index[i - 1]->phys_start,
+				      (ulonglong) PT_LOAD_END(index[i - 1]),
+				      (ulonglong) index[i]->phys_start, (ulonglong) PT_LOAD_END(index[i]));
+			free(index);
+			return;
+		}
+	}
+
+	nd->pt_load_index = index;
+}
+
+/*
+ *  Return the PT_LOAD segment containing paddr, either in its file-backed
+ *  range or in its zero-filled range, or NULL if there is none.  The
+ *  segment found last time is checked first, since consecutive reads
+ *  nearly always come from the same segment.
+ */
+static struct pt_load_segment *pt_load_lookup(physaddr_t paddr)
+{
+	int i, lo, hi, mid;
+	struct pt_load_segment *pls;
+
+	nd->pt_load_lookups++;
+
+	if ((pls = nd->pt_load_last) && (paddr >= pls->phys_start) && (paddr < PT_LOAD_END(pls))) {
+		nd->pt_load_last_hits++;
+		return pls;
+	}
+
+	pls = NULL;
+
+	if (nd->pt_load_index) {
+		lo = 0;
+		hi = nd->num_pt_load_segments - 1;
+		while (lo <= hi) {
+			mid = (lo + hi) / 2;
+			if (paddr < nd->pt_load_index[mid]->phys_start)
+				hi = mid - 1;
+			else if (paddr >= PT_LOAD_END(nd->pt_load_index[mid]))
+				lo = mid + 1;
+			else {
+				pls = nd->pt_load_index[mid];
+				break;
+			}
+		}
+	} else {
+		for (i = 0; i < nd->num_pt_load_segments; i++) {
+			if ((paddr >= nd->pt_load_segments[i].phys_start) &&
+			    (paddr < PT_LOAD_END(&nd->pt_load_segments[i]))) {
+				pls = &nd->pt_load_segments[i];
+				break;
+			}
+		}
+	}
+
+	if (pls)
+		nd->pt_load_last = pls;
+
+	return pls;
+}
+
 /*
  *  Perform any post-dumpfile determination stuff here.
  */
@@ -475,9 +586,132 @@ int netdump_init(char *unused, FILE * fptr)
 
 	check_dumpfile_size(pc->dumpfile);
 
+	if (pc->flags2 & MMAP_DUMPFILE)
+		netdump_mmap_init();
+
 	return TRUE;
 }
 
+/*
+ *  With --mmap_dump, map the whole dumpfile read-only so that
+ *  read_netdump() can copy from the mapping instead of issuing an
+ *  lseek() and read() for each request, and so that netdump_mmap_ptr()
+ *  can hand out pointers into it.  If the mapping cannot be made, the
+ *  file is read as usual.
+ */
+static void netdump_mmap_init(void)
+{
+	struct stat sbuf;
+	void *base;
+
+	if (FLAT_FORMAT()) {
+		error(INFO, "--mmap_dump: not supported with flattened format\n");
+		return;
+	}
+
+	if ((fstat(nd->ndfd, &sbuf) < 0) || !S_ISREG(sbuf.st_mode) || !sbuf.st_size)
+		return;
+
+	if ((ulonglong) sbuf.st_size != (ulonglong) ((size_t) sbuf.st_size)) {
+		error(INFO, "--mmap_dump: %s is too large to map\n", pc->dumpfile);
+		return;
+	}
+
+	base = mmap(NULL, (size_t) sbuf.st_size, PROT_READ, MAP_SHARED, nd->ndfd, 0);
+	if (base == MAP_FAILED) {
+		error(INFO, "--mmap_dump: cannot mmap %s: %s\n", pc->dumpfile, strerror(errno));
+		return;
+	}
+
+	nd->mmap_base = base;
+	nd->mmap_size = sbuf.st_size;
+}
+
+/*
+ *  Translate a physical address into its dumpfile offset, and return
+ *  the number of bytes from there that are backed by the same PT_LOAD
+ *  segment, and are therefore contiguous in the file.  Zero is returned
+ *  if the address is not file-backed.
+ */
+static long netdump_file_extent(physaddr_t paddr, off_t *offset)
+{
+	struct pt_load_segment *pls;
+	physaddr_t len;
+
+	switch (DUMPFILE_FORMAT(nd->flags)) {
+	case NETDUMP_ELF64:
+	case KDUMP_ELF32:
+	case KDUMP_ELF64:
+		break;
+	default:
+		return 0;
+	}
+
+	if (!(pls = pt_load_lookup(paddr)) || (paddr >= pls->phys_end))
+		return 0;
+
+	if (nd->num_pt_load_segments == 1)
+		*offset = (off_t) paddr + (off_t) nd->header_size - (off_t) pls->phys_start;
+	else
+		*offset = (off_t) (paddr - pls->phys_start) + pls->file_offset;
+
+	len = pls->phys_end - paddr;
+
+	return len > INT_MAX ? INT_MAX : (long)len;
+}
+
+/*
+ *  Return how many of the size bytes starting at paddr can be read with
+ *  a single read_netdump() or read_kdump() call, which allows readmem()
+ *  to skip its page-by-page split of physical reads.  Zero means the
+ *  caller should fall back to page-sized requests.
+ */
+long netdump_contiguous(physaddr_t paddr, long size)
+{
+	off_t offset;
+	long len;
+
+	if (!VMCORE_VALID() || FLAT_FORMAT() || XEN_CORE_DUMPFILE())
+		return 0;
+
+	if ((pc->readmem != read_netdump) && (pc->readmem != read_kdump))
+		return 0;
+
+	if ((nd->flags & QEMU_MEM_DUMP_KDUMP_BACKUP) &&
+	    (paddr < nd->backup_src_start + nd->backup_src_size) &&
+	    (paddr + size > nd->backup_src_start))
+		return 0;
+
+	if (!(len = netdump_file_extent(paddr, &offset)))
+		return 0;
+
+	return MIN(len, size);
+}
+
+/*
+ *  Return a pointer to size bytes of physical memory inside the
+ *  --mmap_dump mapping, or NULL if the range is not mapped or not
+ *  contiguous in the dumpfile.  The pointer remains valid for the
+ *  whole session.
+ */
+char *netdump_mmap_ptr(physaddr_t paddr, long size)
+{
+	off_t offset;
+
+	if (!VMCORE_VALID() || !nd->mmap_base)
+		return NULL;
+
+	if (netdump_contiguous(paddr, size) < size)
+		return NULL;
+
+	if (!netdump_file_extent(paddr, &offset) || (offset + size > nd->mmap_size))
+		return NULL;
+
+	nd->mmap_reads++;
+
+	return nd->mmap_base + offset;
+}
+
 /*
  *  Read from a netdump-created dumpfile.
  */
@@ -485,7 +719,6 @@ int read_netdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 {
 	off_t offset;
 	struct pt_load_segment *pls;
-	int i;
 
 	offset = 0;
 
@@ -509,14 +742,10 @@ int read_netdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 			break;
 		}
 
-		for (i = offset = 0; i < nd->num_pt_load_segments; i++) {
-			pls = &nd->pt_load_segments[i];
-			if ((paddr >= pls->phys_start)
-			    && (paddr < pls->phys_end)) {
+		if ((pls = pt_load_lookup(paddr))) {
+			if (paddr < pls->phys_end)
 				offset = (off_t) (paddr - pls->phys_start) + pls->file_offset;
-				break;
-			}
-			if (pls->zero_fill && (paddr >= pls->phys_end) && (paddr < pls->zero_fill)) {
+			else {
 				memset(bufptr, 0, cnt);
 				if (CRASHDEBUG(8))
 					fprintf(fp, "read_netdump: zero-fill: "
@@ -547,6 +776,9 @@ int read_netdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 					"read_flattened_format failed for offset:" " %llx\n", (ulonglong) offset);
 			return READ_ERROR;
 		}
+	} else if (nd->mmap_base && (offset + cnt <= nd->mmap_size)) {
+		memcpy(bufptr, nd->mmap_base + offset, cnt);
+		nd->mmap_reads++;
 	} else {
 		if (lseek(nd->ndfd, offset, SEEK_SET) == -1) {
 			if (CRASHDEBUG(8))
@@ -572,7 +804,6 @@ int write_netdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 {
 	off_t offset;
 	struct pt_load_segment *pls;
-	int i;
 
 	offset = 0;
 
@@ -589,14 +820,8 @@ int write_netdump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 			break;
 		}
 
-		for (i = offset = 0; i < nd->num_pt_load_segments; i++) {
-			pls = &nd->pt_load_segments[i];
-			if ((paddr >= pls->phys_start)
-			    && (paddr < pls->phys_end)) {
-				offset = (off_t) (paddr - pls->phys_start) + pls->file_offset;
-				break;
-			}
-		}
+		if ((pls = pt_load_lookup(paddr)) && (paddr < pls->phys_end))
+			offset = (off_t) (paddr - pls->phys_start) + pls->file_offset;
 
 		if (!offset)
 			return READ_ERROR;
@@ -930,6 +1155,17 @@ int netdump_memory_dump(FILE * fp)
 		netdump_print("               phys_end: %llx\n", pls->phys_end);
 		netdump_print("              zero_fill: %llx\n", pls->zero_fill);
 	}
+	netdump_print("          pt_load_index: %lx %s\n", nd->pt_load_index,
+		      nd->pt_load_index ? "(sorted)" : "(linear search)");
+	netdump_print("        pt_load_lookups: %ld\n", nd->pt_load_lookups);
+	netdump_print("      pt_load_last_hits: %ld ", nd->pt_load_last_hits);
+	if (nd->pt_load_lookups)
+		netdump_print("(%ld%%)\n", nd->pt_load_last_hits * 100 / nd->pt_load_lookups);
+	else
+		netdump_print("\n");
+	netdump_print("              mmap_base: %lx\n", nd->mmap_base);
+	netdump_print("              mmap_size: %llx\n", (ulonglong) nd->mmap_size);
+	netdump_print("             mmap_reads: %ld\n", nd->mmap_reads);
 	netdump_print("             elf_header: %lx\n", nd->elf_header);
 	netdump_print("                  elf32: %lx\n", nd->elf32);
 	netdump_print("                notes32: %lx\n", nd->notes32);
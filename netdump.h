@@ -54,6 +54,13 @@ struct vmcore_data {
 	char *elf_header;
 	uint num_pt_load_segments;
 	struct pt_load_segment *pt_load_segments;
+	struct pt_load_segment **pt_load_index;	/* sorted by phys_start */
+	struct pt_load_segment *pt_load_last;	/* last segment found */
+	ulong pt_load_lookups;
+	ulong pt_load_last_hits;
+	char *mmap_base;		/* --mmap_dump mapping of the dumpfile */
+	off_t mmap_size;
+	ulong mmap_reads;
 	Elf32_Ehdr *elf32;
 	Elf32_Phdr *notes32;
 	Elf32_Phdr *load32;
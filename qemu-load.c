@@ -23,6 +23,7 @@
 #include <string.h>
 #include <assert.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "kvmdump.h"
 
@@ -202,6 +203,130 @@ static void ram_read_blocks(FILE * fp, uint64_t size)
 	}
 }
 
+/*
+ *  Map the whole savevm file read-only, so that ram_load() can decode
+ *  the RAM section headers in place instead of issuing an fseek() for
+ *  every page, and ram_phys_page_ptr() can hand out pointers to pages
+ *  that are stored raw.  If the file cannot be mapped, the stdio path
+ *  is used.
+ */
+static int ram_map_file(struct qemu_device_ram *dram, FILE * fp)
+{
+	struct stat sbuf;
+	void *base;
+
+	if (dram->map_base)
+		return 1;
+	if (dram->map_failed)
+		return 0;
+
+	dram->map_failed = 1;
+
+	if (fstat(fileno(fp), &sbuf) < 0 || !S_ISREG(sbuf.st_mode) ||
+	    sbuf.st_size <= 0 || (size_t) sbuf.st_size != sbuf.st_size)
+		return 0;
+
+	base = mmap(NULL, sbuf.st_size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (base == MAP_FAILED)
+		return 0;
+
+	madvise(base, sbuf.st_size, MADV_SEQUENTIAL);
+
+	dram->map_base = base;
+	dram->map_size = sbuf.st_size;
+	dram->map_failed = 0;
+	return 1;
+}
+
+static inline uint64_t mem_be64(const unsigned char *p)
+{
+	return ((uint64_t) p[0] << 56) | ((uint64_t) p[1] << 48) |
+	    ((uint64_t) p[2] << 40) | ((uint64_t) p[3] << 32) |
+	    ((uint64_t) p[4] << 24) | ((uint64_t) p[5] << 16) |
+	    ((uint64_t) p[6] << 8) | (uint64_t) p[7];
+}
+
+/*
+ *  ram_load() over the mapping of the savevm file: the stream is
+ *  walked with a pointer, and the stdio position is resynchronized
+ *  once the section has been decoded.  A truncated section leaves
+ *  the stream at EOF, as the stdio version would.
+ */
+static uint32_t ram_load_mapped(struct qemu_device *d, FILE * fp)
+{
+	struct qemu_device_ram *dram = (struct qemu_device_ram *)d;
+	const unsigned char *p, *end;
+	static int pc_ram = 0;
+	uint64_t header, addr, size;
+	off_t entry;
+	int sz;
+
+	p = dram->map_base + ftello(fp);
+	end = dram->map_base + dram->map_size;
+
+#define RAM_MAP_NEED(n) do { if ((end - p) < (n)) goto eof; } while (0)
+
+	for (;;) {
+		RAM_MAP_NEED(8);
+		header = mem_be64(p);
+		p += 8;
+		if (header & RAM_SAVE_FLAG_EOS)
+			break;
+
+		assert(!(header & RAM_SAVE_FLAG_FULL));
+
+		addr = header & RAM_SAVE_ADDR_MASK;
+
+		if (header & RAM_SAVE_FLAG_MEM_SIZE) {
+			ram_alloc(dram, addr);
+			if (d->version_id >= 4) {
+				/* The RAM block table: names and sizes.  */
+				for (size = addr; size; size -= mem_be64(p - 8)) {
+					RAM_MAP_NEED(1);
+					sz = *p++;
+					RAM_MAP_NEED(sz + 8);
+					p += sz + 8;
+				}
+			}
+			continue;
+		}
+
+		if (d->version_id >= 4 && !(header & RAM_SAVE_FLAG_CONTINUE)) {
+			RAM_MAP_NEED(1);
+			sz = *p++;
+			RAM_MAP_NEED(sz);
+			pc_ram = (sz == 6) && (memcmp(p, "pc.ram", 6) == 0);
+			p += sz;
+		}
+
+		if (header & RAM_SAVE_FLAG_COMPRESS) {
+			RAM_MAP_NEED(1);
+			entry = RAM_OFFSET_COMPRESSED | *p++;
+			if ((d->version_id == 3)
+			    || (d->version_id >= 4 && pc_ram))
+				store_mapfile_offset(addr, &entry);
+		} else if (header & RAM_SAVE_FLAG_PAGE) {
+			entry = p - dram->map_base;
+			if ((d->version_id == 3)
+			    || (d->version_id >= 4 && pc_ram))
+				store_mapfile_offset(addr, &entry);
+			RAM_MAP_NEED(4096);
+			p += 4096;
+		}
+	}
+
+#undef RAM_MAP_NEED
+
+	fseeko(fp, p - dram->map_base, SEEK_SET);
+	dram->fp = fp;
+	return QEMU_FEATURE_RAM;
+
+ eof:
+	fseeko(fp, 0, SEEK_END);
+	getc(fp);
+	return 0;
+}
+
 static uint32_t ram_load(struct qemu_device *d, FILE * fp, enum qemu_save_section sec)
 {
 	char name[257];
@@ -209,6 +334,9 @@ static uint32_t ram_load(struct qemu_device *d, FILE * fp, enum qemu_save_sectio
 	uint64_t header;
 	static int pc_ram = 0;
 
+	if (ram_map_file(dram, fp))
+		return ram_load_mapped(d, fp);
+
 	for (;;) {
 		uint64_t addr;
 		off_t entry;
@@ -260,6 +388,27 @@ static void ram_free(struct qemu_device *d, struct qemu_device_list *dl)
 {
 	struct qemu_device_ram *dram = (struct qemu_device_ram *)d;
 	free(dram->offsets);
+	if (dram->map_base)
+		munmap(dram->map_base, dram->map_size);
+}
+
+/*
+ *  Return a pointer to a page that is stored raw in the mapped savevm
+ *  file, or NULL if it's compressed, or the file is not mapped.
+ */
+void *ram_phys_page_ptr(struct qemu_device_ram *dram, uint64_t addr)
+{
+	off_t ofs;
+
+	if (!dram->map_base || (addr >= dram->last_ram_offset))
+		return NULL;
+	if (load_mapfile_offset(addr & ~4095ULL, &ofs) < 0)
+		return NULL;
+	if (((ofs & RAM_OFFSET_COMPRESSED) == RAM_OFFSET_COMPRESSED) ||
+	    (ofs < 0) || ((size_t) ofs + 4096 > dram->map_size))
+		return NULL;
+
+	return dram->map_base + ofs + (addr & 4095);
 }
 
 int ram_read_phys_page(struct qemu_device_ram *dram, void *buf, uint64_t addr)
@@ -267,9 +416,15 @@ int ram_read_phys_page(struct qemu_device_ram *dram, void *buf, uint64_t addr)
 	off_t ofs;
 	ssize_t bytes ATTRIBUTE_UNUSED;
 
+	void *page;
+
 	if (addr >= dram->last_ram_offset)
 		return false;
 	assert((addr & 0xfff) == 0);
+	if ((page = ram_phys_page_ptr(dram, addr))) {
+		memcpy(buf, page, 4096);
+		return true;
+	}
 //      ofs = dram->offsets[addr / 4096];
 	if (load_mapfile_offset(addr, &ofs) < 0)
 		return 0;
@@ -69,6 +69,9 @@ struct qemu_device_ram {
 	uint64_t last_ram_offset;
 	FILE *fp;
 	off_t *offsets;
+	unsigned char *map_base;	/* read-only mapping of the savevm file */
+	size_t map_size;
+	int map_failed;
 };
 
 union qemu_uint128_t {
@@ -206,6 +209,7 @@ struct qemu_device *device_find_instance(struct qemu_device_list *, const char *
 struct qemu_device_list *qemu_load(const struct qemu_device_loader *, uint32_t, FILE *);
 
 int ram_read_phys_page(struct qemu_device_ram *, void *, uint64_t);
+void *ram_phys_page_ptr(struct qemu_device_ram *, uint64_t);
 
 /* For a 32-bit KVM host.  */
 extern const struct qemu_device_loader devices_x86_32[];
@@ -37,7 +37,7 @@ static uint64_t paddr_to_pfn(physaddr_t paddr);
 static inline int is_set_bit(char *bitmap, uint64_t pfn);
 static inline int page_is_ram(uint64_t nr);
 static inline int page_is_dumpable(uint64_t nr);
-static int lookup_diskset(uint64_t whole_offset, int *diskid, uint64_t * disk_offset);
+static int lookup_diskset(uint64_t whole_offset, int *diskid, uint64_t * disk_offset, uint64_t * disk_remain);
 static struct tm *efi_time_t_to_tm(const efi_time_t * e);
 static char *guid_to_str(efi_guid_t * guid, char *buf, size_t buflen);
 static int verify_magic_number(uint32_t magicnum[DUMP_PART_HEADER_MAGICNUM_SIZE]);
@@ -51,6 +51,8 @@ static int get_sadump_smram_cpu_state(int cpu, struct sadump_smram_cpu_state
 				      *smram);
 static int block_table_init(void);
 static uint64_t pfn_to_block(uint64_t pfn);
+static int read_sadump_blocks(char *buf, uint64_t block, int nr_blocks);
+static char *sadump_cache_lookup(uint64_t block);
 
 struct sadump_data *sadump_get_sadump_data(void)
 {
@@ -82,7 +84,8 @@ int sadump_cleanup_sadump_data(void)
 	free(sd->diskset_header);
 	free(sd->bitmap);
 	free(sd->dumpable_bitmap);
-	free(sd->page_buf);
+	free(sd->cache_hdr);
+	free(sd->cache_buf);
 	free(sd->block_table);
 	if (sd->sd_list[0])
 		free(sd->sd_list[0]);
@@ -124,7 +127,9 @@ static int read_dump_header(char *file)
 	ulong offset = 0, sub_hdr_offset, data_offset;
 	uint32_t smram_cpu_state_size = 0;
 	ulong bitmap_len, dumpable_bitmap_len;
-	char *bitmap = NULL, *dumpable_bitmap = NULL, *page_buf = NULL;
+	char *bitmap = NULL, *dumpable_bitmap = NULL, *cache_buf = NULL;
+	struct sadump_cache_hdr *cache_hdr = NULL;
+	int i;
 	char guid1[33], guid2[33];
 
 	sph = malloc(block_size);
@@ -346,11 +351,15 @@ static int read_dump_header(char *file)
 
 	data_offset = offset;
 
-	page_buf = malloc(block_size);
-	if (!page_buf) {
-		error(INFO, "sadump: cannot allocate page buffer\n");
+	cache_hdr = calloc(SADUMP_CACHE_CHUNKS, sizeof(struct sadump_cache_hdr));
+	cache_buf = malloc((size_t)SADUMP_CACHE_CHUNKS * SADUMP_CACHE_BLOCKS * block_size);
+	if (!cache_hdr || !cache_buf) {
+		error(INFO, "sadump: cannot allocate page cache\n");
 		goto err;
 	}
+	for (i = 0; i < SADUMP_CACHE_CHUNKS; i++)
+		cache_hdr[i].bufptr = cache_buf +
+		    (size_t)i * SADUMP_CACHE_BLOCKS * block_size;
 
 	sd->filename = file;
 	sd->flags = flags;
@@ -381,7 +390,9 @@ static int read_dump_header(char *file)
 	if (flags & SADUMP_MEDIA)
 		sd->media_header = smh;
 
-	sd->page_buf = page_buf;
+	sd->cache_hdr = cache_hdr;
+	sd->cache_buf = cache_buf;
+	sd->last_hit = -1;
 
 	if (flags & SADUMP_DISKSET) {
 
@@ -428,7 +439,8 @@ static int read_dump_header(char *file)
 	free(smh);
 	free(bitmap);
 	free(dumpable_bitmap);
-	free(page_buf);
+	free(cache_hdr);
+	free(cache_buf);
 	free(sd_list_len_0);
 
 	free(sd->sd_list);
@@ -661,13 +673,14 @@ static inline int page_is_dumpable(uint64_t nr)
 	return is_set_bit(sd->dumpable_bitmap, nr);
 }
 
-static int lookup_diskset(uint64_t whole_offset, int *diskid, uint64_t * disk_offset)
+static int lookup_diskset(uint64_t whole_offset, int *diskid, uint64_t * disk_offset, uint64_t * disk_remain)
 {
 	uint64_t offset = whole_offset;
+	uint64_t ram_size = 0;
 	int i;
 
 	for (i = 0; i < sd->sd_list_len; ++i) {
-		uint64_t used_device_i, ram_size;
+		uint64_t used_device_i;
 		ulong data_offset_i;
 
 		used_device_i = sd->sd_list[i]->header->used_device;
@@ -685,16 +698,167 @@ static int lookup_diskset(uint64_t whole_offset, int *diskid, uint64_t * disk_of
 
 	*diskid = i;
 	*disk_offset = offset;
+	if (disk_remain)
+		*disk_remain = ram_size - offset;
 
 	return TRUE;
 }
 
+/*
+ *  Read up to nr_blocks consecutive dumped blocks, starting with block
+ *  number block, into buf.  On a disk set, the run may span member
+ *  disks.  Returns the number of complete blocks read, which is only
+ *  short if the dumpfile is truncated, or SEEK_ERROR.
+ */
+static int read_sadump_blocks(char *buf, uint64_t block, int nr_blocks)
+{
+	uint64_t whole_offset, perdisk_offset, disk_remain;
+	size_t size, cnt, total;
+	ssize_t done;
+	int dfd;
+
+	whole_offset = block * sd->block_size;
+	total = size = (size_t)nr_blocks * sd->block_size;
+
+	while (size) {
+		if (sd->flags & SADUMP_DISKSET) {
+			int diskid;
+
+			if (!lookup_diskset(whole_offset, &diskid, &perdisk_offset, &disk_remain))
+				return SEEK_ERROR;
+
+			dfd = sd->sd_list[diskid]->dfd;
+			perdisk_offset += sd->sd_list[diskid]->data_offset;
+			cnt = MIN(size, disk_remain);
+
+		} else {
+			dfd = sd->dfd;
+			perdisk_offset = whole_offset + sd->data_offset;
+			cnt = size;
+		}
+
+		done = pread(dfd, buf, cnt, (off_t)perdisk_offset);
+		if (done < 0)
+			return SEEK_ERROR;
+		if (done == 0)
+			break;
+
+		buf += done;
+		whole_offset += done;
+		size -= done;
+	}
+
+	return (total - size) / sd->block_size;
+}
+
+/*
+ *  Hint the kernel to start reading the run of blocks that follows
+ *  chunk, so that it's on its way by the time it is needed.
+ */
+static void sadump_readahead(uint64_t chunk)
+{
+	uint64_t whole_offset, perdisk_offset, disk_remain;
+	int dfd;
+
+	if ((chunk * SADUMP_CACHE_BLOCKS) >= sd->nr_blocks)
+		return;
+
+	whole_offset = chunk * SADUMP_CACHE_BLOCKS * sd->block_size;
+
+	if (sd->flags & SADUMP_DISKSET) {
+		int diskid;
+
+		if (!lookup_diskset(whole_offset, &diskid, &perdisk_offset, &disk_remain))
+			return;
+		dfd = sd->sd_list[diskid]->dfd;
+		perdisk_offset += sd->sd_list[diskid]->data_offset;
+	} else {
+		dfd = sd->dfd;
+		perdisk_offset = whole_offset + sd->data_offset;
+	}
+
+	posix_fadvise(dfd, (off_t)perdisk_offset,
+	    (off_t)SADUMP_CACHE_BLOCKS * sd->block_size, POSIX_FADV_WILLNEED);
+	sd->readaheads++;
+}
+
+/*
+ *  Return a pointer to the cached copy of a dumped block.  On a miss,
+ *  the run of SADUMP_CACHE_BLOCKS blocks containing it is read with a
+ *  single system call into the entry selected by the CLOCK hand, and if
+ *  the previous miss was on the preceding run, the next run is read
+ *  ahead as well.
+ */
+static char *sadump_cache_lookup(uint64_t block)
+{
+	struct sadump_cache_hdr *sch;
+	uint64_t chunk;
+	int i, nr_blocks, ret;
+
+	chunk = block / SADUMP_CACHE_BLOCKS;
+	sd->accesses++;
+
+	if ((sd->last_hit >= 0) && (sd->cache_hdr[sd->last_hit].chunk == chunk) &&
+	    sd->cache_hdr[sd->last_hit].nr_blocks) {
+		sch = &sd->cache_hdr[sd->last_hit];
+		goto found;
+	}
+
+	for (i = 0; i < SADUMP_CACHE_CHUNKS; i++) {
+		sch = &sd->cache_hdr[i];
+		if (sch->nr_blocks && (sch->chunk == chunk)) {
+			sd->last_hit = i;
+			goto found;
+		}
+	}
+
+	for (;;) {
+		i = sd->evict_index;
+		sd->evict_index = (sd->evict_index + 1) % SADUMP_CACHE_CHUNKS;
+		sch = &sd->cache_hdr[i];
+		if (!sch->nr_blocks)
+			break;
+		if (sch->referenced) {
+			sch->referenced = FALSE;
+			continue;
+		}
+		sd->evictions++;
+		break;
+	}
+
+	nr_blocks = MIN(SADUMP_CACHE_BLOCKS, sd->nr_blocks - chunk * SADUMP_CACHE_BLOCKS);
+	sch->nr_blocks = 0;
+	if (sd->last_hit == i)
+		sd->last_hit = -1;
+	if ((ret = read_sadump_blocks(sch->bufptr, chunk * SADUMP_CACHE_BLOCKS, nr_blocks)) <= 0)
+		return ret == SEEK_ERROR ? NULL : (char *)-1;
+	sch->chunk = chunk;
+	sch->nr_blocks = ret;
+	sch->referenced = TRUE;
+	sd->last_hit = i;
+
+	if (sd->last_miss == chunk)
+		sadump_readahead(chunk + 1);
+	sd->last_miss = chunk + 1;
+
+	if ((block % SADUMP_CACHE_BLOCKS) >= ret)
+		return (char *)-1;
+	return sch->bufptr + (block % SADUMP_CACHE_BLOCKS) * sd->block_size;
+
+found:
+	if ((block % SADUMP_CACHE_BLOCKS) >= sch->nr_blocks)
+		return (char *)-1;
+	sch->referenced = TRUE;
+	sd->cached_reads++;
+	return sch->bufptr + (block % SADUMP_CACHE_BLOCKS) * sd->block_size;
+}
+
 int read_sadump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 {
 	physaddr_t curpaddr ATTRIBUTE_UNUSED;
-	uint64_t pfn, whole_offset, perdisk_offset, block;
+	uint64_t pfn, block;
 	ulong page_offset;
-	int dfd;
+	char *blockptr;
 
 	if (sd->flags & SADUMP_KDUMP_BACKUP &&
 	    paddr >= sd->backup_src_start && paddr < sd->backup_src_start + sd->backup_src_size) {
@@ -723,31 +887,15 @@ int read_sadump(int fd, void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 	}
 
 	block = pfn_to_block(pfn);
-
-	whole_offset = block * sd->block_size;
-
-	if (sd->flags & SADUMP_DISKSET) {
-		int diskid;
-
-		if (!lookup_diskset(whole_offset, &diskid, &perdisk_offset))
-			return SEEK_ERROR;
-
-		dfd = sd->sd_list[diskid]->dfd;
-		perdisk_offset += sd->sd_list[diskid]->data_offset;
-
-	} else {
-		dfd = sd->dfd;
-		perdisk_offset = whole_offset + sd->data_offset;
-
-	}
-
-	if (lseek(dfd, perdisk_offset, SEEK_SET) == failed)
+	if (block >= sd->nr_blocks)
 		return SEEK_ERROR;
 
-	if (read(dfd, sd->page_buf, sd->block_size) != sd->block_size)
+	if ((blockptr = sadump_cache_lookup(block)) == NULL)
+		return SEEK_ERROR;
+	if (blockptr == (char *)-1)
 		return READ_ERROR;
 
-	memcpy(bufptr, sd->page_buf + page_offset, cnt);
+	memcpy(bufptr, blockptr + page_offset, cnt);
 
 	return cnt;
 }
@@ -990,8 +1138,21 @@ int sadump_memory_dump(FILE * fp)
 	fprintf(fp, "       data_offset: %lx\n", sd->data_offset);
 	fprintf(fp, "        block_size: %d\n", sd->block_size);
 	fprintf(fp, "       block_shift: %d\n", sd->block_shift);
-	fprintf(fp, "          page_buf: %lx\n", (ulong) sd->page_buf);
 	fprintf(fp, "       block_table: %lx\n", (ulong) sd->block_table);
+	fprintf(fp, "          nr_words: %ld\n", sd->nr_words);
+	fprintf(fp, "         nr_blocks: %lld\n", (ulonglong) sd->nr_blocks);
+	fprintf(fp, "         cache_hdr: %lx (%d x %d blocks)\n", (ulong) sd->cache_hdr,
+		SADUMP_CACHE_CHUNKS, SADUMP_CACHE_BLOCKS);
+	fprintf(fp, "         cache_buf: %lx\n", (ulong) sd->cache_buf);
+	fprintf(fp, "       evict_index: %d\n", sd->evict_index);
+	fprintf(fp, "          accesses: %ld\n", sd->accesses);
+	fprintf(fp, "      cached_reads: %ld ", sd->cached_reads);
+	if (sd->accesses)
+		fprintf(fp, "(%ld%%)\n", sd->cached_reads * 100 / sd->accesses);
+	else
+		fprintf(fp, "\n");
+	fprintf(fp, "         evictions: %ld\n", sd->evictions);
+	fprintf(fp, "        readaheads: %ld\n", sd->readaheads);
 	fprintf(fp, "       sd_list_len: %d\n", sd->sd_list_len);
 	fprintf(fp, "           sd_list: %lx\n", (ulong) sd->sd_list);
 	fprintf(fp, "  backup_src_start: %llx\n", sd->backup_src_start);
@@ -1456,47 +1617,67 @@ void sadump_show_diskset(void)
 	}
 }
 
+/*
+ *  Return the 64 dumpable bits of bitmap word w, with pfn (w * 64) in
+ *  bit 0 regardless of host byte order.
+ */
+static inline ulonglong dumpable_word(ulong w)
+{
+	unsigned char *p = (unsigned char *)&sd->dumpable_bitmap[w * (SADUMP_WORD_BITS / 8)];
+
+	return (ulonglong) p[0] | (ulonglong) p[1] << 8 |
+	    (ulonglong) p[2] << 16 | (ulonglong) p[3] << 24 |
+	    (ulonglong) p[4] << 32 | (ulonglong) p[5] << 40 |
+	    (ulonglong) p[6] << 48 | (ulonglong) p[7] << 56;
+}
+
+/*
+ *  Build the rank index of the dumpable bitmap: for each 64-bit word,
+ *  the number of dumpable pages in all of the words that precede it.
+ *  Since only dumpable pages are stored, that is also the block number
+ *  of the first dumpable page in the word.
+ */
 static int block_table_init(void)
 {
-	uint64_t pfn, section, max_section, *block_table;
+	ulong w, nr_words;
+	uint64_t *block_table;
 
-	max_section = divideup(sd->dump_header->max_mapnr, SADUMP_PF_SECTION_NUM);
+	nr_words = MIN(divideup(sd->dump_header->max_mapnr, SADUMP_WORD_BITS),
+	    ((ulong)sd->dump_header->dumpable_bitmap_blocks * sd->block_size) /
+	    (SADUMP_WORD_BITS / 8));
 
-	block_table = calloc(sizeof(uint64_t), max_section);
+	block_table = malloc((nr_words + 1) * sizeof(uint64_t));
 	if (!block_table) {
 		error(INFO, "sadump: cannot allocate memory for block_table\n");
 		return FALSE;
 	}
 
-	for (section = 0; section < max_section; ++section) {
-		if (section > 0)
-			block_table[section] = block_table[section - 1];
-		for (pfn = section * SADUMP_PF_SECTION_NUM; pfn < (section + 1) * SADUMP_PF_SECTION_NUM; ++pfn)
-			if (page_is_dumpable(pfn))
-				block_table[section]++;
-	}
-
+	sd->nr_words = nr_words;
 	sd->block_table = block_table;
 
+	block_table[0] = 0;
+	for (w = 0; w < nr_words; w++)
+		block_table[w + 1] = block_table[w] +
+		    __builtin_popcountll(dumpable_word(w));
+
+	sd->nr_blocks = block_table[nr_words];
+
 	return TRUE;
 }
 
+/*
+ *  Return the number of dumpable pages preceding pfn.
+ */
 static uint64_t pfn_to_block(uint64_t pfn)
 {
-	uint64_t block, section, p;
-
-	section = pfn / SADUMP_PF_SECTION_NUM;
-
-	if (section)
-		block = sd->block_table[section - 1];
-	else
-		block = 0;
+	ulong w = pfn / SADUMP_WORD_BITS;
+	int bit = pfn % SADUMP_WORD_BITS;
 
-	for (p = section * SADUMP_PF_SECTION_NUM; p < pfn; ++p)
-		if (page_is_dumpable(p))
-			block++;
+	if (w >= sd->nr_words)
+		return sd->nr_blocks;
 
-	return block;
+	return sd->block_table[w] +
+	    __builtin_popcountll(dumpable_word(w) & ((1ULL << bit) - 1));
 }
 
 int sadump_is_zero_excluded(void)
@@ -166,7 +166,17 @@ struct sadump_media_header {
 
 #define divideup(x, y)	(((x) + ((y) - 1)) / (y))
 
-#define SADUMP_PF_SECTION_NUM 4096
+#define SADUMP_WORD_BITS	(64)	/* pfns covered by one block_table entry */
+
+#define SADUMP_CACHE_CHUNKS	(64)	/* number of cached block runs */
+#define SADUMP_CACHE_BLOCKS	(32)	/* blocks read in per cache miss */
+
+struct sadump_cache_hdr {
+	uint64_t chunk;		/* first block / SADUMP_CACHE_BLOCKS */
+	int nr_blocks;		/* valid blocks, 0 if unused */
+	int referenced;
+	char *bufptr;
+};
 
 struct sadump_diskset_data {
 	char *filename;
@@ -196,8 +206,20 @@ struct sadump_data {
 	int block_size;
 	int block_shift;
 
-	char *page_buf;
-	uint64_t *block_table;
+	uint64_t *block_table;	/* dumpable pages preceding each bitmap word */
+	ulong nr_words;		/* number of block_table entries, less one */
+	uint64_t nr_blocks;	/* total number of dumped blocks */
+
+	/* block cache */
+	struct sadump_cache_hdr *cache_hdr;
+	char *cache_buf;
+	int evict_index;	/* CLOCK hand */
+	int last_hit;
+	uint64_t last_miss;	/* chunk of the last cache miss, plus one */
+	ulong accesses;
+	ulong cached_reads;
+	ulong evictions;
+	ulong readaheads;
 
 	int sd_list_len;
 	struct sadump_diskset_data **sd_list;
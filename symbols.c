@@ -54,9 +54,12 @@ static int ascii_long(ulong word);
 static int is_bfd_format(char *);
 static int is_binary_stripped(char *);
 static int namespace_ctl(int, struct symbol_namespace *, void *, void *);
-static void symval_hash_init(void);
-static struct syment *symval_hash_search(ulong);
+static void symval_init(void);
+static long symval_search(ulong);
+static struct syment *module_symval_start(struct load_module *, struct syment *, struct syment *, ulong);
 static void symname_hash_init(void);
+static uint symname_hash_value(char *);
+static void symname_hash_alloc(ulong);
 static void symname_hash_install(struct syment *);
 static struct syment *symname_hash_search(char *);
 static void gnu_qsort(bfd *, void *, long, unsigned int, asymbol *, asymbol *);
@@ -214,7 +217,7 @@ void symtab_init(void)
 	}
 
 	symname_hash_init();
-	symval_hash_init();
+	symval_init();
 }
 
 /*
@@ -643,7 +646,7 @@ static void store_sysmap_symbols(void)
 	namespace_ctl(NAMESPACE_COMPLETE, &st->kernel_namespace, st->symtable, st->symend);
 
 	symname_hash_init();
-	symval_hash_init();
+	symval_init();
 }
 
 /*
@@ -742,81 +745,74 @@ static int relocate_force(ulong symval, char *symname)
 }
 
 /*
- *  Install all static kernel symbol values into the symval_hash.
+ *  Copy the values of the static kernel symbols, which are stored in
+ *  increasing numerical order, into a flat array that symval_search()
+ *  can binary search without striding through the syment structures.
  */
-static void symval_hash_init(void)
+static void symval_init(void)
 {
-	int index;
-	struct syment *sp, *sph;
-
-	for (sp = st->symtable; sp < st->symend; sp++) {
-		index = SYMVAL_HASH_INDEX(sp->value);
+	long i;
 
-		if (st->symval_hash[index].val_hash_head == NULL) {
-			st->symval_hash[index].val_hash_head = sp;
-			st->symval_hash[index].val_hash_last = sp;
-			continue;
-		}
+	if (st->symval)
+		free(st->symval);
 
-		sph = st->symval_hash[index].val_hash_head;
-		while (sph->val_hash_next)
-			sph = sph->val_hash_next;
+	if ((st->symval = (ulong *)malloc(MAX(st->symcnt, 1) * sizeof(ulong))) == NULL)
+		error(FATAL, "symbol value array malloc: %s\n", strerror(errno));
 
-		sph->val_hash_next = sp;
-	}
+	for (i = 0; i < st->symcnt; i++)
+		st->symval[i] = st->symtable[i].value;
 }
 
 /*
- *  Static kernel symbol value search
+ *  Static kernel symbol value search: return the index of the first
+ *  symbol whose value is greater than or equal to the value, or
+ *  st->symcnt if there is none.  The loop body has no data-dependent
+ *  branches, so it compiles into conditional moves.
  */
-static struct syment *symval_hash_search(ulong value)
+static long symval_search(ulong value)
 {
-	int index;
-	struct syment *sp, *splo;
-
-	index = SYMVAL_HASH_INDEX(value);
-
-	if (!st->symval_hash[index].val_hash_head)
-		return NULL;
-
-	st->val_hash_searches += 1;
-	st->val_hash_iterations += 1;
+	ulong *base;
+	long n, half;
 
-	if (st->symval_hash[index].val_hash_last->value <= value)
-		sp = st->symval_hash[index].val_hash_last;
-	else
-		sp = st->symval_hash[index].val_hash_head;
-
-	for (splo = NULL; sp; sp = sp->val_hash_next) {
-		if (sp->value == value) {
-			st->symval_hash[index].val_hash_last = sp;
-			return sp;
-		}
-
-		if (sp->value > value)
-			break;
+	if (!(n = st->symcnt))
+		return 0;
 
-		st->val_hash_iterations += 1;
+	st->val_searches += 1;
 
-		splo = sp;
+	for (base = st->symval; n > 1; n -= half) {
+		half = n / 2;
+		base = (base[half] < value) ? base + half : base;
+		st->val_iterations += 1;
 	}
 
-	if (splo)
-		st->symval_hash[index].val_hash_last = splo;
-
-	return splo;
+	return (base - st->symval) + (*base < value);
 }
 
 /*
- *  Store all kernel static symbols into the symname_hash.
+ *  Store all kernel static symbols into the symname_hash, an open-addressed
+ *  table that holds the first syment of each distinct name along with the
+ *  hash value of the name, so that probes only compare strings when the
+ *  hash values match.  Once all the symbols are installed, each syment's
+ *  cnt is set to the number of kernel symbols sharing its name.
  */
 static void symname_hash_init(void)
 {
 	struct syment *sp;
 
+	free(st->symname_hash);
+	free(st->symname_hashval);
+	st->symname_hash = NULL;
+	st->symname_hashval = NULL;
+	symname_hash_alloc(st->symcnt * 2);
+
 	for (sp = st->symtable; sp < st->symend; sp++)
 		symname_hash_install(sp);
 
+	for (sp = st->symtable; sp < st->symend; sp++)
+		sp->cnt = symname_hash_search(sp->name)->cnt;
+
+	st->name_searches = st->name_probes = 0;
+
 	if ((sp = symbol_search("__per_cpu_start")))
 		st->__per_cpu_start = sp->value;
 	if ((sp = symbol_search("__per_cpu_end")))
@@ -824,47 +820,107 @@ static void symname_hash_init(void)
 }
 
 /*
- *  Install a single static kernel symbol into the symname_hash.
+ *  FNV-1a hash of a symbol name.
+ */
+static uint symname_hash_value(char *name)
+{
+	uint hash;
+
+	for (hash = 2166136261U; *name; name++) {
+		hash ^= (unsigned char)*name;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+ *  Allocate a symname_hash with at least cnt slots, moving over the
+ *  entries of the current one, if any.
+ */
+static void symname_hash_alloc(ulong cnt)
+{
+	struct syment **old_hash;
+	uint *old_hashval;
+	ulong i, index, mask, size, old_size;
+
+	for (size = 1024; size < cnt; size <<= 1) ;
+
+	old_hash = st->symname_hash;
+	old_hashval = st->symname_hashval;
+	old_size = st->symname_hash_size;
+
+	if (((st->symname_hash = (struct syment **)calloc(size, sizeof(struct syment *))) == NULL) ||
+	    ((st->symname_hashval = (uint *)calloc(size, sizeof(uint))) == NULL))
+		error(FATAL, "symbol name hash malloc: %s\n", strerror(errno));
+	st->symname_hash_size = size;
+	st->symname_hash_cnt = 0;
+	mask = size - 1;
+
+	for (i = 0; old_hash && (i < old_size); i++) {
+		if (!old_hash[i])
+			continue;
+		for (index = old_hashval[i] & mask; st->symname_hash[index]; index = (index + 1) & mask) ;
+		st->symname_hash[index] = old_hash[i];
+		st->symname_hashval[index] = old_hashval[i];
+		st->symname_hash_cnt++;
+	}
+
+	free(old_hash);
+	free(old_hashval);
+}
+
+/*
+ *  Install a single static kernel symbol into the symname_hash, or if its
+ *  name is already there, count it as another instance of that name.
  */
 static void symname_hash_install(struct syment *spn)
 {
 	struct syment *sp;
-	int index;
+	ulong mask, index;
+	uint hash;
 
-	index = SYMNAME_HASH_INDEX(spn->name);
-	spn->cnt = 1;
+	if ((st->symname_hash_cnt + 1) * 2 > st->symname_hash_size)
+		symname_hash_alloc(st->symname_hash_size * 2);
 
-	if ((sp = st->symname_hash[index]) == NULL)
-		st->symname_hash[index] = spn;
-	else {
-		while (sp) {
-			if (STREQ(sp->name, spn->name)) {
-				sp->cnt++;
-				spn->cnt++;
-			}
-			if (sp->name_hash_next)
-				sp = sp->name_hash_next;
-			else {
-				sp->name_hash_next = spn;
-				break;
-			}
+	hash = symname_hash_value(spn->name);
+	mask = st->symname_hash_size - 1;
+
+	for (index = hash & mask; (sp = st->symname_hash[index]); index = (index + 1) & mask) {
+		if ((st->symname_hashval[index] == hash) && STREQ(sp->name, spn->name)) {
+			sp->cnt++;
+			return;
 		}
 	}
+
+	spn->cnt = 1;
+	st->symname_hash[index] = spn;
+	st->symname_hashval[index] = hash;
+	st->symname_hash_cnt++;
 }
 
 /*
- *  Static kernel symbol value search
+ *  Static kernel symbol name search, returning the first kernel symbol
+ *  having the name.
  */
 static struct syment *symname_hash_search(char *name)
 {
 	struct syment *sp;
+	ulong mask, index;
+	uint hash;
 
-	sp = st->symname_hash[SYMNAME_HASH_INDEX(name)];
+	if (!st->symname_hash)
+		return NULL;
+
+	hash = symname_hash_value(name);
+	mask = st->symname_hash_size - 1;
+
+	st->name_searches += 1;
 
-	while (sp) {
-		if (STREQ(sp->name, name))
+	for (index = hash & mask; (sp = st->symname_hash[index]); index = (index + 1) & mask) {
+		st->name_probes += 1;
+		if ((st->symname_hashval[index] == hash) && STREQ(sp->name, name))
 			return sp;
-		sp = sp->name_hash_next;
 	}
 
 	return NULL;
@@ -2423,7 +2479,7 @@ int is_rodata(ulong value, struct syment **spp)
  */
 void dump_symbol_table(void)
 {
-	int i, s, cnt, tot;
+	int i, s;
 	struct load_module *lm;
 	struct syment *sp;
 	int others;
@@ -2486,56 +2542,16 @@ void dump_symbol_table(void)
 		fprintf(fp, "       __per_cpu_end: (unused)\n");
 	}
 
-	fprintf(fp, "    symval_hash[%d]: %lx\n", SYMVAL_HASH, (ulong) & st->symval_hash[0]);
-
-	if (CRASHDEBUG(1)) {
-		fprintf(fp, "   ");
-		for (i = 0; i < SYMVAL_HASH; i++) {
-			fprintf(fp, " [%3d]: ", i);
-
-			sp = st->symval_hash[i].val_hash_head;
-			if (!sp) {
-				fprintf(fp, "  0 ");
-			} else {
-				cnt = 1;
-				while ((sp = sp->val_hash_next))
-					cnt++;
-
-				fprintf(fp, "%3d ", cnt);
-			}
-
-			if (i && (((i + 1) % 6) == 0))
-				fprintf(fp, "\n   ");
-		}
-	}
-
-	fprintf(fp, "%s   val_hash_searches: %.0f\n", CRASHDEBUG(1) ? "\n" : "", st->val_hash_searches);
-	fprintf(fp, " val_hash_iterations: %.0f  (avg: %.1f)\n",
-		st->val_hash_iterations, st->val_hash_iterations / st->val_hash_searches);
-
-	fprintf(fp, "   symname_hash[%d]: %lx\n", SYMNAME_HASH, (ulong) & st->symname_hash[0]);
+	fprintf(fp, "              symval: %lx\n", (ulong) st->symval);
+	fprintf(fp, "        val_searches: %.0f\n", st->val_searches);
+	fprintf(fp, "      val_iterations: %.0f  (avg: %.1f)\n",
+		st->val_iterations, st->val_searches ? st->val_iterations / st->val_searches : 0);
 
-	if (CRASHDEBUG(1)) {
-		fprintf(fp, "    ");
-		for (i = tot = 0; i < SYMNAME_HASH; i++) {
-			fprintf(fp, "[%3d]: ", i);
-			if ((sp = st->symname_hash[i]) == NULL)
-				fprintf(fp, "%3d  ", 0);
-			else {
-				cnt = 1;
-				while (sp->name_hash_next) {
-					cnt++;
-					sp = sp->name_hash_next;
-				}
-				fprintf(fp, "%3d  ", cnt);
-				tot += cnt;
-			}
-			if (i && (((i + 1) % 6) == 0))
-				fprintf(fp, "\n    ");
-		}
-		if (SYMNAME_HASH % 6)
-			fprintf(fp, "\n");
-	}
+	fprintf(fp, "        symname_hash: %lx  (%ld of %ld slots used)\n", (ulong) st->symname_hash,
+		st->symname_hash_cnt, st->symname_hash_size);
+	fprintf(fp, "       name_searches: %.0f\n", st->name_searches);
+	fprintf(fp, "         name_probes: %.0f  (avg: %.1f)\n",
+		st->name_probes, st->name_searches ? st->name_probes / st->name_searches : 0);
 	fprintf(fp, "    symbol_namespace: ");
 	fprintf(fp, "address: %lx  ", (ulong) st->kernel_namespace.address);
 	fprintf(fp, "index: %ld  ", st->kernel_namespace.index);
@@ -3540,11 +3556,14 @@ struct syment *symbol_search(char *s)
 	struct load_module *lm;
 	int pseudos, search_init;
 
-	sp_hashed = symname_hash_search(s);
-
-	for (sp = sp_hashed ? sp_hashed : st->symtable; sp < st->symend; sp++) {
-		if (STREQ(s, sp->name))
-			return (sp);
+	if (st->symname_hash) {
+		if ((sp_hashed = symname_hash_search(s)))
+			return (sp_hashed);
+	} else {
+		for (sp = st->symtable; sp < st->symend; sp++) {
+			if (STREQ(s, sp->name))
+				return (sp);
+		}
 	}
 
 	pseudos = (strstr(s, "_MODULE_START_") || strstr(s, "_MODULE_END_"));
@@ -3857,6 +3876,8 @@ struct syment *value_search_module(ulong value, ulong * offset)
 		if (sp->value > value)	/* invalid -- between modules */
 			break;
 
+		sp = module_symval_start(lm, sp, sp_end, value);
+
 		/*
 		 *  splast will contain the last module symbol encountered.
 		 *  Note: "__insmod_"-type symbols will be set in splast only
@@ -3919,12 +3940,39 @@ struct syment *value_search_module(ulong value, ulong * offset)
 	return ((struct syment *)NULL);
 }
 
+/*
+ *  Binary search a module's symbols for the last ordinary symbol below
+ *  the value, where value_search_module() can start its scan: symbols
+ *  before it cannot affect the result, since it replaces any earlier
+ *  candidate for the closest symbol.  If there is no such symbol, the
+ *  scan starts at the beginning.
+ */
+static struct syment *module_symval_start(struct load_module *lm, struct syment *sp,
+					  struct syment *sp_end, ulong value)
+{
+	struct syment *base;
+	long n, half;
+
+	for (base = sp, n = sp_end - sp + 1; n > 1; n -= half) {
+		half = n / 2;
+		base = (base[half].value < value) ? base + half : base;
+	}
+
+	for ( ; (base > sp) && (base->value < value); base--) {
+		if (!MODULE_PSEUDO_SYMBOL(base) && !is_insmod_builtin(lm, base))
+			return base;
+	}
+
+	return sp;
+}
+
 /*
  *  Return the syment of the symbol closest to the value, along with
  *  the offset from the symbol value if requested.
  */
 struct syment *value_search(ulong value, ulong * offset)
 {
+	long i;
 	struct syment *sp, *spnext;
 
 	if (!in_ksymbol_range(value))
@@ -3936,15 +3984,15 @@ struct syment *value_search(ulong value, ulong * offset)
 	if (IS_VMALLOC_ADDR(value))
 		goto check_modules;
 
-	if ((sp = symval_hash_search(value)) == NULL)
-		sp = st->symtable;
+	i = symval_search(value);
 
-	for (; sp < st->symend; sp++) {
+	if (i < st->symcnt) {
+		sp = &st->symtable[i];
 		if (value == sp->value) {
 #if !defined(GDB_5_3) && !defined(GDB_6_0) && !defined(GDB_6_1)
 			if (STRNEQ(sp->name, ".text.")) {
 				spnext = sp + 1;
-				if (spnext->value == value)
+				if ((spnext < st->symend) && (spnext->value == value))
 					sp = spnext;
 			}
 #endif
@@ -3952,7 +4000,7 @@ struct syment *value_search(ulong value, ulong * offset)
 				*offset = 0;
 			return ((struct syment *)sp);
 		}
-		if (sp->value > value) {
+		if (i) {
 			if (offset)
 				*offset = value - ((sp - 1)->value);
 			return ((struct syment *)(sp - 1));
@@ -3986,25 +4034,22 @@ ulong highest_bss_symbol(void)
  */
 struct syment *value_search_base_kernel(ulong value, ulong * offset)
 {
+	long i;
 	struct syment *sp;
 
 	if (value < st->symtable[0].value)
 		return ((struct syment *)NULL);
 
-	if ((sp = symval_hash_search(value)) == NULL)
-		sp = st->symtable;
-
-	for (; sp < st->symend; sp++) {
+	if ((i = symval_search(value)) < st->symcnt) {
+		sp = &st->symtable[i];
 		if (value == sp->value) {
 			if (offset)
 				*offset = 0;
 			return ((struct syment *)sp);
 		}
-		if (sp->value > value) {
-			if (offset)
-				*offset = value - ((sp - 1)->value);
-			return ((struct syment *)(sp - 1));
-		}
+		if (offset)
+			*offset = value - ((sp - 1)->value);
+		return ((struct syment *)(sp - 1));
 	}
 
 	/*
@@ -4516,7 +4561,15 @@ int get_syment_array(char *symbol, struct syment **sp_array, int max)
 
 	cnt = 0;
 
-	for (sp = st->symtable; sp < st->symend; sp++) {
+	/*
+	 *  Start at the first kernel symbol with the name, if there is one.
+	 */
+	if (!st->symname_hash)
+		sp = st->symtable;
+	else if (!(sp = symname_hash_search(symbol)))
+		sp = st->symend;
+
+	for (; sp < st->symend; sp++) {
 		if ((*symbol == *(sp->name)) && STREQ(symbol, sp->name)) {
 			if (!sp_array)
 				return sp->cnt;
@@ -4572,6 +4625,403 @@ void datatype_init(void)
 	BZERO(&array_table, sizeof(array_table));
 }
 
+/*
+ *  Persistent cache of the gdb responses behind datatype_info() and
+ *  ANON_MEMBER_OFFSET(), enabled with --type_cache.  The cache file is
+ *  named after the vmlinux build-id, or if there is none, after the size
+ *  and modification time of the file holding the debuginfo.  Only lookups
+ *  made during initialization are cached and replayed, since debuginfo
+ *  loaded later with "mod -s" can change the result of a lookup; that is
+ *  also where the offset_table and size_table are filled, so a session
+ *  with a warm cache fills them without asking gdb at all.
+ */
+#define DATATYPE_CACHE_MAGIC   "crash datatype cache"
+#define DATATYPE_CACHE_VERSION (1)
+#define DATATYPE_CACHE_HASH    (4096)
+
+#define DATATYPE_CACHE_UNUSED    (0)
+#define DATATYPE_CACHE_ACTIVE    (1)
+#define DATATYPE_CACHE_DISABLED  (2)
+
+struct datatype_cache_entry {
+	char *key;		/* "D:name[.member]" or "A:name.member" */
+	int failed;
+	int typecode;
+	ulong length;
+	int is_typedef;
+	long member_offset;
+	long member_length;
+	int member_typecode;
+	int member_bitsize;
+	int member_base_typecode;
+	int member_base_unsigned;
+	int member_target_typecode;
+	struct datatype_cache_entry *next;
+};
+
+static struct datatype_cache {
+	char *dir;
+	char *file;
+	int state;
+	ulong entries;
+	ulong loaded;
+	ulong added;
+	ulong hits;
+	ulong misses;
+	struct datatype_cache_entry *hash[DATATYPE_CACHE_HASH];
+} datatype_cache = { 0 };
+
+static ulong datatype_cache_hash_index(char *s)
+{
+	ulong hash;
+
+	for (hash = 0; *s; s++)
+		hash = (hash * 31) + *s;
+
+	return hash % DATATYPE_CACHE_HASH;
+}
+
+static void datatype_cache_key(char *key, int kind, char *name, char *member)
+{
+	if (member)
+		sprintf(key, "%c:%s.%s", kind, name, member);
+	else
+		sprintf(key, "%c:%s", kind, name);
+}
+
+/*
+ *  Set the directory that holds the cache files.
+ */
+void set_datatype_cache(char *dir)
+{
+	struct stat sbuf;
+
+	if ((stat(dir, &sbuf) < 0) || !S_ISDIR(sbuf.st_mode)) {
+		error(INFO, "--type_cache: %s: not a directory\n", dir);
+		return;
+	}
+
+	datatype_cache.dir = dir;
+}
+
+/*
+ *  The cache file is named after the hex digits of the NT_GNU_BUILD_ID
+ *  note, which every kernel built with a modern binutils carries.
+ */
+static char *datatype_cache_filename(void)
+{
+	asection *sect;
+	bfd_size_type size;
+	unsigned char *note;
+	ulong namesz, descsz, i;
+	char id[BUFSIZE], *file, *p;
+	struct stat sbuf;
+
+	id[0] = NULLCHAR;
+	note = NULL;
+
+	if (st->bfd &&
+	    (sect = bfd_get_section_by_name(st->bfd, ".note.gnu.build-id")) &&
+	    ((size = bfd_section_size(st->bfd, sect)) > 12) &&
+	    (note = malloc(size)) &&
+	    bfd_get_section_contents(st->bfd, sect, note, (file_ptr)0, size)) {
+		namesz = bfd_get_32(st->bfd, note);
+		descsz = bfd_get_32(st->bfd, note + 4);
+		p = (char *)note + 12 + roundup(namesz, 4);
+		if (descsz && (descsz < (BUFSIZE/2)) &&
+		    ((p + descsz) <= ((char *)note + size))) {
+			for (i = 0; i < descsz; i++)
+				sprintf(&id[i*2], "%02x", (unsigned char)p[i]);
+		}
+	}
+	free(note);
+
+	if (!strlen(id)) {
+		file = pc->namelist_debug ? pc->namelist_debug : pc->namelist;
+		if (!file || (stat(file, &sbuf) < 0))
+			return NULL;
+		sprintf(id, "%s-%lx-%lx", basename(file),
+			(ulong)sbuf.st_size, (ulong)sbuf.st_mtime);
+	}
+
+	if (!(file = malloc(strlen(datatype_cache.dir) + strlen(id) + 16)))
+		return NULL;
+	sprintf(file, "%s/%s.types", datatype_cache.dir, id);
+
+	return file;
+}
+
+static struct datatype_cache_entry *datatype_cache_lookup(char *key)
+{
+	struct datatype_cache_entry *dce;
+
+	for (dce = datatype_cache.hash[datatype_cache_hash_index(key)]; dce; dce = dce->next) {
+		if (STREQ(dce->key, key))
+			return dce;
+	}
+
+	return NULL;
+}
+
+static struct datatype_cache_entry *datatype_cache_add(char *key)
+{
+	struct datatype_cache_entry *dce;
+	ulong hash;
+
+	if (!(dce = calloc(1, sizeof(struct datatype_cache_entry))) ||
+	    !(dce->key = strdup(key))) {
+		free(dce);
+		return NULL;
+	}
+
+	hash = datatype_cache_hash_index(key);
+	dce->next = datatype_cache.hash[hash];
+	datatype_cache.hash[hash] = dce;
+	datatype_cache.entries++;
+
+	return dce;
+}
+
+/*
+ *  A cache file that does not exist yet, or that has a different
+ *  header, is simply ignored and rewritten at the end of initialization.
+ */
+static void datatype_cache_load(void)
+{
+	struct datatype_cache *dtc;
+	struct datatype_cache_entry *dce;
+	FILE *cfp;
+	char buf[BUFSIZE*2];
+	char *key, *p;
+	int version;
+
+	dtc = &datatype_cache;
+	dtc->state = DATATYPE_CACHE_DISABLED;
+
+	if (!(dtc->file = datatype_cache_filename()))
+		return;
+
+	dtc->state = DATATYPE_CACHE_ACTIVE;
+
+	if (!(cfp = fopen(dtc->file, "r")))
+		return;
+
+	if (!fgets(buf, sizeof(buf), cfp) ||
+	    !STRNEQ(buf, DATATYPE_CACHE_MAGIC) ||
+	    (sscanf(buf + strlen(DATATYPE_CACHE_MAGIC), "%d", &version) != 1) ||
+	    (version != DATATYPE_CACHE_VERSION)) {
+		error(INFO, "%s: invalid type cache file ignored\n", dtc->file);
+		fclose(cfp);
+		return;
+	}
+
+	while (fgets(buf, sizeof(buf), cfp)) {
+		key = buf;
+		if (!(p = strchr(buf, '\t')))
+			continue;
+		*p++ = NULLCHAR;
+		if (datatype_cache_lookup(key) || !(dce = datatype_cache_add(key)))
+			continue;
+		if (sscanf(p, "%d %d %lu %d %ld %ld %d %d %d %d %d",
+		    &dce->failed, &dce->typecode, &dce->length,
+		    &dce->is_typedef, &dce->member_offset,
+		    &dce->member_length, &dce->member_typecode,
+		    &dce->member_bitsize, &dce->member_base_typecode,
+		    &dce->member_base_unsigned,
+		    &dce->member_target_typecode) != 11)
+			dce->failed = -1;   /* unusable: treat as a miss */
+		else
+			dtc->loaded++;
+	}
+
+	fclose(cfp);
+
+	if (CRASHDEBUG(1))
+		fprintf(fp, "%s: loaded %ld type cache entries\n",
+			dtc->file, dtc->loaded);
+}
+
+/*
+ *  Return the cache entry to use for a lookup made during initialization,
+ *  loading the cache file on first use, or NULL if the cache is not in use.
+ */
+static struct datatype_cache_entry *datatype_cache_entry(char *key, int *found)
+{
+	struct datatype_cache *dtc;
+	struct datatype_cache_entry *dce;
+
+	dtc = &datatype_cache;
+	*found = FALSE;
+
+	if (!dtc->dir || (pc->flags & RUNTIME))
+		return NULL;
+
+	if (dtc->state == DATATYPE_CACHE_UNUSED)
+		datatype_cache_load();
+	if (dtc->state != DATATYPE_CACHE_ACTIVE)
+		return NULL;
+
+	if ((dce = datatype_cache_lookup(key)) && (dce->failed >= 0)) {
+		dtc->hits++;
+		*found = TRUE;
+		return dce;
+	}
+
+	dtc->misses++;
+	if (dce)
+		return dce;
+	if ((dce = datatype_cache_add(key)))
+		dce->failed = -1;
+
+	return dce;
+}
+
+/*
+ *  Replaces gdb_interface() for the GNU_GET_DATATYPE requests made
+ *  by datatype_info().  Requests that return an enumerator tagname
+ *  are not cached.
+ */
+static void datatype_cache_request(struct gnu_request *req)
+{
+	struct datatype_cache_entry *dce;
+	char key[BUFSIZE*2];
+	int found;
+
+	if ((strlen(req->name) + (req->member ? strlen(req->member) : 0)) >= BUFSIZE) {
+		gdb_interface(req);
+		return;
+	}
+
+	datatype_cache_key(key, 'D', req->name, req->member);
+
+	if (!(dce = datatype_cache_entry(key, &found))) {
+		gdb_interface(req);
+		return;
+	}
+
+	if (found) {
+		if (dce->failed)
+			req->flags |= GNU_COMMAND_FAILED;
+		req->typecode = dce->typecode;
+		req->length = dce->length;
+		req->is_typedef = dce->is_typedef;
+		req->member_offset = dce->member_offset;
+		req->member_length = dce->member_length;
+		req->member_typecode = dce->member_typecode;
+		req->member_bitsize = dce->member_bitsize;
+		req->member_base_typecode = dce->member_base_typecode;
+		req->member_base_unsigned = dce->member_base_unsigned;
+		req->member_target_typecode = dce->member_target_typecode;
+		return;
+	}
+
+	gdb_interface(req);
+
+	if (req->tagname)
+		return;
+
+	dce->failed = req->flags & GNU_COMMAND_FAILED ? TRUE : FALSE;
+	dce->typecode = req->typecode;
+	dce->length = req->length;
+	dce->is_typedef = req->is_typedef;
+	dce->member_offset = req->member_offset;
+	dce->member_length = req->member_length;
+	dce->member_typecode = req->member_typecode;
+	dce->member_bitsize = req->member_bitsize;
+	dce->member_base_typecode = req->member_base_typecode;
+	dce->member_base_unsigned = req->member_base_unsigned;
+	dce->member_target_typecode = req->member_target_typecode;
+	datatype_cache.added++;
+}
+
+/*
+ *  Saving the cache is strictly best-effort.  It is written to a
+ *  temporary file and renamed so that a concurrent session never
+ *  sees a partial one.
+ */
+void datatype_cache_save(void)
+{
+	struct datatype_cache *dtc;
+	struct datatype_cache_entry *dce;
+	FILE *cfp;
+	char *tmpname;
+	int i, fd, ok;
+	ulong saved;
+
+	dtc = &datatype_cache;
+	saved = 0;
+
+	if ((dtc->state != DATATYPE_CACHE_ACTIVE) || !dtc->added)
+		return;
+
+	if (!(tmpname = malloc(strlen(dtc->file) + 32)))
+		return;
+	sprintf(tmpname, "%s.%d", dtc->file, (int)getpid());
+
+	if (((fd = open(tmpname, O_WRONLY|O_CREAT|O_EXCL, 0644)) < 0) ||
+	    !(cfp = fdopen(fd, "w"))) {
+		if (CRASHDEBUG(1))
+			error(INFO, "cannot create %s: %s\n",
+				tmpname, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmpname);
+		}
+		free(tmpname);
+		return;
+	}
+
+	ok = fprintf(cfp, "%s %d\n", DATATYPE_CACHE_MAGIC,
+		DATATYPE_CACHE_VERSION) > 0;
+
+	for (i = 0; ok && (i < DATATYPE_CACHE_HASH); i++) {
+		for (dce = dtc->hash[i]; ok && dce; dce = dce->next) {
+			if (dce->failed < 0)
+				continue;
+			ok = fprintf(cfp, "%s\t%d %d %lu %d %ld %ld %d %d %d %d %d\n",
+				dce->key, dce->failed, dce->typecode,
+				dce->length, dce->is_typedef,
+				dce->member_offset, dce->member_length,
+				dce->member_typecode, dce->member_bitsize,
+				dce->member_base_typecode,
+				dce->member_base_unsigned,
+				dce->member_target_typecode) > 0;
+			saved++;
+		}
+	}
+
+	if (fclose(cfp) != 0)
+		ok = FALSE;
+
+	if (!ok || (rename(tmpname, dtc->file) < 0)) {
+		if (CRASHDEBUG(1))
+			error(INFO, "cannot write %s\n", dtc->file);
+		unlink(tmpname);
+	} else if (CRASHDEBUG(1))
+		fprintf(fp, "%s: saved %ld type cache entries\n",
+			dtc->file, saved);
+
+	dtc->added = 0;
+	free(tmpname);
+}
+
+void dump_datatype_cache(FILE *ofp)
+{
+	struct datatype_cache *dtc;
+
+	dtc = &datatype_cache;
+
+	fprintf(ofp, "\n                 datatype_cache:\n");
+	fprintf(ofp, "                            dir: %s\n",
+		dtc->dir ? dtc->dir : "(not set)");
+	fprintf(ofp, "                           file: %s\n",
+		dtc->file ? dtc->file : "(none)");
+	fprintf(ofp, "                        entries: %ld\n", dtc->entries);
+	fprintf(ofp, "                         loaded: %ld\n", dtc->loaded);
+	fprintf(ofp, "                           hits: %ld\n", dtc->hits);
+	fprintf(ofp, "                         misses: %ld\n", dtc->misses);
+}
+
 /*
  *  This function is called through the following macros:
  *
@@ -4607,7 +5057,7 @@ long datatype_info(char *name, char *member, struct datatype_member *dm)
 	req->member = member;
 	req->fp = pc->nullfp;
 
-	gdb_interface(req);
+	datatype_cache_request(req);
 	if (req->flags & GNU_COMMAND_FAILED) {
 		FREEBUF(req);
 		return -1;
@@ -4615,12 +5065,12 @@ long datatype_info(char *name, char *member, struct datatype_member *dm)
 
 	if (!req->typecode) {
 		sprintf(buf, "struct %s", name);
-		gdb_interface(req);
+		datatype_cache_request(req);
 	}
 
 	if (!req->typecode) {
 		sprintf(buf, "union %s", name);
-		gdb_interface(req);
+		datatype_cache_request(req);
 	}
 
 	member_typecode = TYPE_CODE_UNDEF;
@@ -4763,9 +5213,17 @@ long datatype_info(char *name, char *member, struct datatype_member *dm)
  */
 static long anon_member_offset(char *name, char *member)
 {
+	struct datatype_cache_entry *dce;
 	char buf[BUFSIZE];
 	ulong value;
-	int type;
+	int type, found;
+
+	dce = NULL;
+	if ((strlen(name) + strlen(member)) < (BUFSIZE - 4)) {
+		datatype_cache_key(buf, 'A', name, member);
+		if ((dce = datatype_cache_entry(buf, &found)) && found)
+			return dce->member_offset;
+	}
 
 	value = -1;
 	type = STRUCT_REQUEST;
@@ -4791,6 +5249,12 @@ static long anon_member_offset(char *name, char *member)
 
 	close_tmpfile2();
 
+	if (dce) {
+		dce->failed = FALSE;
+		dce->member_offset = value;
+		datatype_cache.added++;
+	}
+
 	return value;
 }
 
@@ -4898,6 +5362,181 @@ void dump_struct(char *s, ulong addr, unsigned radix)
 	restore_current_radix(restore_radix);
 }
 
+/*
+ *  Layouts of the structure members printed by dump_struct_member(),
+ *  resolved once per "struct.member" string.  Integer members that are
+ *  not bit-fields or chars, and pointers to data, are printed directly
+ *  from memory in the same format that gdb uses for them.  Everything
+ *  else, and any pointer value that gdb might annotate with a symbol
+ *  name, is left to gdb.
+ */
+#define MEMBER_FORMAT_GDB  (0)
+#define MEMBER_FORMAT_INT  (1)
+#define MEMBER_FORMAT_PTR  (2)
+
+#define MEMBER_FORMAT_HASH (128)
+
+static struct member_format {
+	char *name;		/* "struct.member" */
+	char *member;
+	long offset;
+	long size;
+	int format;
+	int is_unsigned;
+	struct member_format *next;
+} *member_format_hash[MEMBER_FORMAT_HASH];
+
+static ulong member_format_hash_index(char *s)
+{
+	ulong hash;
+
+	for (hash = 0; *s; s++)
+		hash = (hash * 31) + *s;
+
+	return hash % MEMBER_FORMAT_HASH;
+}
+
+static struct member_format *lookup_member_format(char *s)
+{
+	struct member_format *mf;
+
+	for (mf = member_format_hash[member_format_hash_index(s)]; mf; mf = mf->next) {
+		if (STREQ(mf->name, s))
+			return mf;
+	}
+
+	return NULL;
+}
+
+static struct member_format *get_member_format(char *s, char *name, char *member)
+{
+	struct member_format *mf;
+	struct gnu_request *req;
+	char buf[BUFSIZE];
+	ulong hash;
+
+	if ((mf = lookup_member_format(s)))
+		return mf;
+
+	hash = member_format_hash_index(s);
+
+	if (!(mf = calloc(1, sizeof(struct member_format))) ||
+	    !(mf->name = strdup(s))) {
+		free(mf);
+		return NULL;
+	}
+	mf->member = strstr(mf->name, ".") + 1;
+	mf->format = MEMBER_FORMAT_GDB;
+
+	if (strlen(name) < (BUFSIZE - strlen("union "))) {
+		req = (struct gnu_request *)GETBUF(sizeof(struct gnu_request));
+		req->command = GNU_GET_DATATYPE;
+		req->flags |= GNU_RETURN_ON_ERROR;
+		req->name = buf;
+		req->member = member;
+		req->fp = pc->nullfp;
+
+		strcpy(buf, name);
+		gdb_interface(req);
+		if (!(req->flags & GNU_COMMAND_FAILED) && !req->typecode) {
+			sprintf(buf, "struct %s", name);
+			gdb_interface(req);
+		}
+		if (!(req->flags & GNU_COMMAND_FAILED) && !req->typecode) {
+			sprintf(buf, "union %s", name);
+			gdb_interface(req);
+		}
+
+		if (!(req->flags & GNU_COMMAND_FAILED) && req->typecode &&
+		    (req->member_offset >= 0) && !(req->member_offset % BITS_PER_BYTE) &&
+		    !req->member_bitsize) {
+			mf->offset = req->member_offset / BITS_PER_BYTE;
+			mf->size = req->member_length;
+			mf->is_unsigned = req->member_base_unsigned;
+
+			switch (req->member_base_typecode) {
+			case TYPE_CODE_INT:
+				if ((mf->size == 2) || (mf->size == 4) || (mf->size == 8))
+					mf->format = MEMBER_FORMAT_INT;
+				break;
+			case TYPE_CODE_PTR:
+				switch (req->member_target_typecode) {
+				case TYPE_CODE_STRUCT:
+				case TYPE_CODE_UNION:
+				case TYPE_CODE_VOID:
+				case TYPE_CODE_PTR:
+					if (mf->size == sizeof(void *))
+						mf->format = MEMBER_FORMAT_PTR;
+					break;
+				}
+				break;
+			}
+		}
+
+		FREEBUF(req);
+	}
+
+	mf->next = member_format_hash[hash];
+	member_format_hash[hash] = mf;
+
+	return mf;
+}
+
+/*
+ *  Print a member described by a MEMBER_FORMAT_INT or MEMBER_FORMAT_PTR
+ *  format, returning FALSE if it should be left to gdb.
+ */
+static int print_member_native(struct member_format *mf, ulong addr, unsigned radix)
+{
+	union {
+		ushort u16;
+		uint u32;
+		ulonglong u64;
+	} data;
+	ulonglong value;
+	int hex;
+
+	if ((mf->format == MEMBER_FORMAT_GDB) ||
+	    !readmem(addr + mf->offset, KVADDR, &data, mf->size,
+	    "structure member", RETURN_ON_ERROR|QUIET))
+		return FALSE;
+
+	if ((radix != 10) && (radix != 16))
+		radix = *gdb_output_radix;
+	hex = (radix == 16);
+
+	switch (mf->size) {
+	case 2:
+		value = mf->is_unsigned ? data.u16 : (ulonglong)(short)data.u16;
+		break;
+	case 4:
+		value = mf->is_unsigned ? data.u32 : (ulonglong)(int)data.u32;
+		break;
+	default:
+		value = data.u64;
+		break;
+	}
+
+	if (mf->format == MEMBER_FORMAT_PTR) {
+		/*
+		 *  Leave anything gdb may annotate with a <symbol> to gdb.
+		 */
+		if (value && (!IS_KVADDR(value) || IS_MODULE_VADDR(value) ||
+		    value_search(value, NULL)))
+			return FALSE;
+		fprintf(fp, "  %s = 0x%llx\n", mf->member, value);
+	} else if (hex) {
+		if (mf->size < sizeof(ulonglong))
+			value &= (1ULL << (mf->size * BITS_PER_BYTE)) - 1;
+		fprintf(fp, "  %s = 0x%llx\n", mf->member, value);
+	} else if (mf->is_unsigned)
+		fprintf(fp, "  %s = %llu\n", mf->member, value);
+	else
+		fprintf(fp, "  %s = %lld\n", mf->member, (long long)value);
+
+	return TRUE;
+}
+
 /*
  *  Externally available routine to dump a structure member, given the
  *  base structure address.  The input string must be in struct.member format.
@@ -4905,9 +5544,16 @@ void dump_struct(char *s, ulong addr, unsigned radix)
 void dump_struct_member(char *s, ulong addr, unsigned radix)
 {
 	struct datatype_member datatype_member, *dm;
+	struct member_format *mf;
 	unsigned restore_radix;
 	char *buf, *p1;
 
+	/*
+	 *  A cached layout has already been checked below.
+	 */
+	if ((mf = lookup_member_format(s)) && print_member_native(mf, addr, radix))
+		return;
+
 	restore_radix = 0;
 	buf = GETBUF(strlen(s) + 1);
 	strcpy(buf, s);
@@ -4929,6 +5575,12 @@ void dump_struct_member(char *s, ulong addr, unsigned radix)
 		error(FATAL, "invalid structure member name: %s\n", dm->member);
 	}
 
+	if (!mf && (mf = get_member_format(s, dm->name, dm->member)) &&
+	    print_member_native(mf, addr, radix)) {
+		FREEBUF(buf);
+		return;
+	}
+
 	set_temporary_radix(radix, &restore_radix);
 
 	open_tmpfile();
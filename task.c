@@ -102,6 +102,48 @@ static void show_last_run(struct task_context *);
 static int sort_by_last_run(const void *arg1, const void *arg2);
 static void sort_context_array_by_last_run(void);
 static void irqstacks_init(void);
+static void clear_task_index(void);
+static void task_index_update(void);
+static void task_index_tgids(void);
+static int task_index_lookup(ulong);
+static struct task_context *next_tgid_context(ulong, struct task_context *);
+static ulong read_task_tgid(ulong);
+
+/*
+ *  The task_struct, thread_info and mm_struct buffers are each backed by a
+ *  small cache of recently-read objects, so that commands that alternate
+ *  between tasks don't re-read the same structures over and over.  The
+ *  tt->task_struct, tt->thread_info and tt->mm_struct pointers refer to the
+ *  cache slot of the object most recently filled, as identified by the
+ *  tt->last_*_read addresses.  Slots are replaced in CLOCK order.  Dumpfile
+ *  contents never change, so on dumpfiles the caches are never cleared; on
+ *  live systems clear_task_cache() empties them before each command.
+ */
+#define TASK_OBJECT_CACHE_SLOTS  (64)
+
+struct task_object_cache {
+	char *name;
+	char *type;
+	long size;
+	char *buf;
+	ulong addr[TASK_OBJECT_CACHE_SLOTS];
+	char referenced[TASK_OBJECT_CACHE_SLOTS];
+	int last;
+	int hand;
+	ulong hits;
+	ulong misses;
+};
+
+static struct task_object_cache task_struct_cache = { "task_struct", "fill_task_struct" };
+static struct task_object_cache thread_info_cache = { "thread_info", "fill_thread_info" };
+static struct task_object_cache mm_struct_cache = { "mm_struct", "fill_mm_struct" };
+
+static char *task_object_cache_init(struct task_object_cache *, long);
+static void task_object_cache_clear(struct task_object_cache *);
+static int task_object_cache_find(struct task_object_cache *, ulong);
+static int task_object_cache_victim(struct task_object_cache *);
+static char *task_object_cache_fill(struct task_object_cache *, ulong, char *);
+static void dump_task_object_cache(struct task_object_cache *);
 
 /*
  *  Figure out how much space will be required to hold the task context
@@ -316,14 +358,10 @@ void task_init(void)
 	if (VALID_MEMBER(runqueue_arrays))
 		MEMBER_OFFSET_INIT(task_struct_run_list, "task_struct", "run_list");
 
-	if ((tt->task_struct = (char *)malloc(SIZE(task_struct))) == NULL)
-		error(FATAL, "cannot malloc task_struct space.");
-
-	if ((tt->mm_struct = (char *)malloc(SIZE(mm_struct))) == NULL)
-		error(FATAL, "cannot malloc mm_struct space.");
-
-	if ((tt->flags & THREAD_INFO) && ((tt->thread_info = (char *)malloc(SIZE(thread_info))) == NULL))
-		error(FATAL, "cannot malloc thread_info space.");
+	tt->task_struct = task_object_cache_init(&task_struct_cache, SIZE(task_struct));
+	tt->mm_struct = task_object_cache_init(&mm_struct_cache, SIZE(mm_struct));
+	if (tt->flags & THREAD_INFO)
+		tt->thread_info = task_object_cache_init(&thread_info_cache, SIZE(thread_info));
 
 	STRUCT_SIZE_INIT(task_union, "task_union");
 	STRUCT_SIZE_INIT(thread_union, "thread_union");
@@ -2195,10 +2233,25 @@ static void refresh_context(ulong curtask, ulong curpid)
  */
 void sort_context_array(void)
 {
-	ulong curtask;
+	ulong i, curtask;
+	struct task_context *tc;
+
+	/*
+	 *  Leave an already-sorted array alone so that the task index
+	 *  remains valid; on dumpfiles this is the case for every command
+	 *  after the first.
+	 */
+	tc = FIRST_CONTEXT();
+	for (i = 1; i < RUNNING_TASKS(); i++, tc++) {
+		if (sort_by_pid(tc, tc + 1) > 0)
+			break;
+	}
+	if (i >= RUNNING_TASKS())
+		return;
 
 	curtask = CURRENT_TASK();
 	qsort((void *)tt->context_array, (size_t) tt->running_tasks, sizeof(struct task_context), sort_by_pid);
+	clear_task_index();
 	set_context(curtask, NO_PID);
 }
 
@@ -2236,47 +2289,159 @@ static void sort_context_array_by_last_run(void)
 
 	curtask = CURRENT_TASK();
 	qsort((void *)tt->context_array, (size_t) tt->running_tasks, sizeof(struct task_context), sort_by_last_run);
+	clear_task_index();
 	set_context(curtask, NO_PID);
 }
 
+static char *task_object_cache_init(struct task_object_cache *oc, long size)
+{
+	oc->size = size;
+	if ((oc->buf = (char *)calloc(TASK_OBJECT_CACHE_SLOTS, size)) == NULL)
+		error(FATAL, "cannot malloc %s space.", oc->name);
+
+	return oc->buf;
+}
+
+static void task_object_cache_clear(struct task_object_cache *oc)
+{
+	BZERO(oc->addr, sizeof(oc->addr));
+	BZERO(oc->referenced, sizeof(oc->referenced));
+}
+
+/*
+ *  Return the slot holding the object at addr, or -1 if it isn't cached.
+ */
+static int task_object_cache_find(struct task_object_cache *oc, ulong addr)
+{
+	int i;
+
+	if (!addr)
+		return -1;
+
+	if (oc->addr[oc->last] == addr)
+		return oc->last;
+
+	for (i = 0; i < TASK_OBJECT_CACHE_SLOTS; i++) {
+		if (oc->addr[i] == addr)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ *  Pick a slot for a new object, skipping over recently used ones.
+ */
+static int task_object_cache_victim(struct task_object_cache *oc)
+{
+	int i;
+
+	for (;;) {
+		i = oc->hand;
+		oc->hand = (oc->hand + 1) % TASK_OBJECT_CACHE_SLOTS;
+		if (!oc->addr[i] || !oc->referenced[i])
+			return i;
+		oc->referenced[i] = 0;
+	}
+}
+
+/*
+ *  Return a pointer to the cached copy of the object at addr, reading it
+ *  into a free or reclaimed slot if necessary.  If src is non-NULL, the
+ *  object is copied from there instead of being read.
+ */
+static char *task_object_cache_fill(struct task_object_cache *oc, ulong addr, char *src)
+{
+	int i;
+	char *objp;
+
+	if ((i = task_object_cache_find(oc, addr)) >= 0) {
+		objp = oc->buf + (i * oc->size);
+		if (src)
+			BCOPY(src, objp, oc->size);
+		else
+			oc->hits++;
+	} else {
+		i = task_object_cache_victim(oc);
+		objp = oc->buf + (i * oc->size);
+		oc->addr[i] = 0;
+
+		if (src)
+			BCOPY(src, objp, oc->size);
+		else {
+			oc->misses++;
+			if (!readmem(addr, KVADDR, objp, oc->size, oc->type,
+				     ACTIVE()? (RETURN_ON_ERROR | QUIET) : RETURN_ON_ERROR))
+				return NULL;
+		}
+
+		oc->addr[i] = addr;
+	}
+
+	oc->referenced[i] = 1;
+	oc->last = i;
+
+	return objp;
+}
+
+static void dump_task_object_cache(struct task_object_cache *oc)
+{
+	int i, cached;
+
+	for (i = cached = 0; i < TASK_OBJECT_CACHE_SLOTS; i++) {
+		if (oc->addr[i])
+			cached++;
+	}
+
+	fprintf(fp, "%12s cache: %d of %d cached, %ld hits, %ld misses",
+		oc->name, cached, TASK_OBJECT_CACHE_SLOTS, oc->hits, oc->misses);
+	if (oc->hits + oc->misses)
+		fprintf(fp, " (%ld%% hit rate)", (oc->hits * 100) / (oc->hits + oc->misses));
+	fprintf(fp, "\n");
+}
+
 /*
- *  Keep a stash of the last task_struct accessed.  Chances are it will
- *  be hit several times before the next task is accessed.
+ *  Keep a stash of the task_structs accessed.  Chances are the last one
+ *  will be hit several times before the next task is accessed.
  */
 
 char *fill_task_struct(ulong task)
 {
+	char *tp;
+
 	if (XEN_HYPER_MODE())
 		return NULL;
 
 	if (!IS_LAST_TASK_READ(task)) {
-		if (!readmem(task, KVADDR, tt->task_struct,
-			     SIZE(task_struct), "fill_task_struct",
-			     ACTIVE()? (RETURN_ON_ERROR | QUIET) : RETURN_ON_ERROR)) {
+		if (!(tp = task_object_cache_fill(&task_struct_cache, task, NULL))) {
 			tt->last_task_read = 0;
 			return NULL;
 		}
-	}
+		tt->task_struct = tp;
+	} else
+		task_struct_cache.hits++;
 
 	tt->last_task_read = task;
 	return (tt->task_struct);
 }
 
 /*
- *  Keep a stash of the last thread_info struct accessed.  Chances are it will
- *  be hit several times before the next task is accessed.
+ *  Keep a stash of the thread_info structs accessed.  Chances are the last
+ *  one will be hit several times before the next task is accessed.
  */
 
 char *fill_thread_info(ulong thread_info)
 {
+	char *tip;
+
 	if (!IS_LAST_THREAD_INFO_READ(thread_info)) {
-		if (!readmem(thread_info, KVADDR, tt->thread_info,
-			     SIZE(thread_info), "fill_thread_info",
-			     ACTIVE()? (RETURN_ON_ERROR | QUIET) : RETURN_ON_ERROR)) {
+		if (!(tip = task_object_cache_fill(&thread_info_cache, thread_info, NULL))) {
 			tt->last_thread_info_read = 0;
 			return NULL;
 		}
-	}
+		tt->thread_info = tip;
+	} else
+		thread_info_cache.hits++;
 
 	tt->last_thread_info_read = thread_info;
 	return (tt->thread_info);
@@ -2302,7 +2467,7 @@ void fill_stackbuf(struct bt_info *bt)
 
 	if (!IS_LAST_TASK_READ(bt->task)) {
 		if (bt->stackbase == bt->task) {
-			BCOPY(bt->stackbuf, tt->task_struct, SIZE(task_struct));
+			tt->task_struct = task_object_cache_fill(&task_struct_cache, bt->task, bt->stackbuf);
 			tt->last_task_read = bt->task;
 		} else
 			fill_task_struct(bt->task);
@@ -2329,26 +2494,35 @@ void alter_stackbuf(struct bt_info *bt)
 
 char *fill_mm_struct(ulong mm)
 {
+	char *mp;
+
 	if (!IS_LAST_MM_READ(mm)) {
-		if (!readmem(mm, KVADDR, tt->mm_struct,
-			     SIZE(mm_struct), "fill_mm_struct",
-			     ACTIVE()? (RETURN_ON_ERROR | QUIET) : RETURN_ON_ERROR)) {
+		if (!(mp = task_object_cache_fill(&mm_struct_cache, mm, NULL))) {
 			tt->last_mm_read = 0;
 			return NULL;
 		}
-	}
+		tt->mm_struct = mp;
+	} else
+		mm_struct_cache.hits++;
 
 	tt->last_mm_read = mm;
 	return (tt->mm_struct);
 }
 
 /*
- *  If active, clear out references to the last task and mm_struct read.
+ *  If active, clear out the cached task_struct, thread_info and mm_struct
+ *  data.
  */
 void clear_task_cache(void)
 {
-	if (ACTIVE())
+	if (ACTIVE()) {
 		tt->last_task_read = tt->last_mm_read = 0;
+		tt->last_thread_info_read = 0;
+		task_object_cache_clear(&task_struct_cache);
+		task_object_cache_clear(&thread_info_cache);
+		task_object_cache_clear(&mm_struct_cache);
+		clear_task_index();
+	}
 }
 
 /*
@@ -3526,7 +3700,6 @@ static void child_list(ulong task)
  */
 static void show_tgid_list(ulong task)
 {
-	int i;
 	int cnt;
 	struct task_context *tc;
 	ulong tgid;
@@ -3548,18 +3721,15 @@ static void show_tgid_list(ulong task)
 
 	print_task_header(fp, tc, 0);
 
-	tc = FIRST_CONTEXT();
-	for (i = cnt = 0; i < RUNNING_TASKS(); i++, tc++) {
+	for (cnt = 0, tc = next_tgid_context(tgid, NULL); tc; tc = next_tgid_context(tgid, tc)) {
 		if (tc->task == task)
 			continue;
 
-		if (task_tgid(tc->task) == tgid) {
-			INDENT(2);
-			print_task_header(fp, tc, 0);
-			cnt++;
-			if (tc->pid == 0)
-				pc->curcmd_flags |= IDLE_TASK_SHOWN;
-		}
+		INDENT(2);
+		print_task_header(fp, tc, 0);
+		cnt++;
+		if (tc->pid == 0)
+			pc->curcmd_flags |= IDLE_TASK_SHOWN;
 	}
 
 	if (!cnt)
@@ -3568,18 +3738,220 @@ static void show_tgid_list(ulong task)
 	fprintf(fp, "\n");
 }
 
+/*
+ *  Hashed indexes into the context_array, keyed by task address, pid and
+ *  tgid, used by the lookup functions below instead of walking the whole
+ *  array.  The pid and tgid chains are kept in array order, so a lookup
+ *  finds the same task_context that a linear scan would.  The index is
+ *  cleared whenever the array is refreshed or re-sorted, and contexts
+ *  appended to the array since it was built are hashed on the next lookup.
+ *  The tgid index requires reading each task_struct, so it is only built
+ *  when a tgid lookup is first made.
+ */
+struct task_index {
+	struct task_context *context_array;	/* array that was indexed */
+	ulong indexed;		/* contexts hashed by task and pid */
+	ulong tgids;		/* contexts hashed by tgid */
+	ulong slots;		/* size of the per-context arrays */
+	ulong buckets;		/* power of 2 */
+	int *task_head;
+	int *pid_head;
+	int *pid_tail;
+	int *tgid_head;
+	int *tgid_tail;
+	int *task_next;
+	int *pid_next;
+	int *tgid_next;
+	ulong *tgid;
+	ulong builds;
+	ulong lookups;
+};
+
+static struct task_index task_index = { 0 };
+static struct task_index *ti = &task_index;
+
+#define TASK_INDEX_MIN_BUCKETS  (1024)
+#define TASK_INDEX_END          (-1)
+
+static inline ulong task_index_hash(ulong value)
+{
+	value ^= value >> 17;
+	value *= 0x9e3779b1UL;
+	value ^= value >> 15;
+
+	return value & (ti->buckets - 1);
+}
+
+static void clear_task_index(void)
+{
+	ti->context_array = NULL;
+	ti->indexed = ti->tgids = 0;
+}
+
+static void *task_index_realloc(void *ptr, ulong cnt, size_t size)
+{
+	if (!(ptr = realloc(ptr, cnt * size)))
+		error(FATAL, "cannot realloc task index (%ld entries)\n", cnt);
+
+	return ptr;
+}
+
+/*
+ *  Make sure every context in the array is hashed by task address and pid,
+ *  starting over if the array has been moved, shrunk or cleared, or if it
+ *  has outgrown the hash buckets.
+ */
+static void task_index_update(void)
+{
+	ulong i, b, buckets;
+	struct task_context *tc;
+
+	if (!ti->context_array || (ti->context_array != tt->context_array) ||
+	    (ti->indexed > RUNNING_TASKS()) || (RUNNING_TASKS() > ti->buckets)) {
+		for (buckets = TASK_INDEX_MIN_BUCKETS; buckets < (RUNNING_TASKS() * 2); buckets <<= 1) ;
+
+		if (buckets != ti->buckets) {
+			ti->task_head = task_index_realloc(ti->task_head, buckets, sizeof(int));
+			ti->pid_head = task_index_realloc(ti->pid_head, buckets, sizeof(int));
+			ti->pid_tail = task_index_realloc(ti->pid_tail, buckets, sizeof(int));
+			ti->tgid_head = task_index_realloc(ti->tgid_head, buckets, sizeof(int));
+			ti->tgid_tail = task_index_realloc(ti->tgid_tail, buckets, sizeof(int));
+			ti->buckets = buckets;
+		}
+
+		for (b = 0; b < ti->buckets; b++)
+			ti->task_head[b] = ti->pid_head[b] = ti->tgid_head[b] = TASK_INDEX_END;
+
+		ti->context_array = tt->context_array;
+		ti->indexed = ti->tgids = 0;
+		ti->builds++;
+	}
+
+	if (RUNNING_TASKS() > ti->slots) {
+		ti->slots = MAX(RUNNING_TASKS(), tt->max_tasks);
+		ti->task_next = task_index_realloc(ti->task_next, ti->slots, sizeof(int));
+		ti->pid_next = task_index_realloc(ti->pid_next, ti->slots, sizeof(int));
+		ti->tgid_next = task_index_realloc(ti->tgid_next, ti->slots, sizeof(int));
+		ti->tgid = task_index_realloc(ti->tgid, ti->slots, sizeof(ulong));
+	}
+
+	for (i = ti->indexed, tc = FIRST_CONTEXT() + i; i < RUNNING_TASKS(); i++, tc++) {
+		b = task_index_hash(tc->task);
+		ti->task_next[i] = ti->task_head[b];
+		ti->task_head[b] = i;
+
+		b = task_index_hash(tc->pid);
+		ti->pid_next[i] = TASK_INDEX_END;
+		if (ti->pid_head[b] == TASK_INDEX_END)
+			ti->pid_head[b] = i;
+		else
+			ti->pid_next[ti->pid_tail[b]] = i;
+		ti->pid_tail[b] = i;
+	}
+
+	ti->indexed = RUNNING_TASKS();
+}
+
+/*
+ *  Hash any contexts that have not yet been hashed by tgid.
+ */
+static void task_index_tgids(void)
+{
+	ulong i, b;
+	struct task_context *tc;
+
+	task_index_update();
+
+	for (i = ti->tgids, tc = FIRST_CONTEXT() + i; i < ti->indexed; i++, tc++) {
+		ti->tgid[i] = read_task_tgid(tc->task);
+
+		b = task_index_hash(ti->tgid[i]);
+		ti->tgid_next[i] = TASK_INDEX_END;
+		if (ti->tgid_head[b] == TASK_INDEX_END)
+			ti->tgid_head[b] = i;
+		else
+			ti->tgid_next[ti->tgid_tail[b]] = i;
+		ti->tgid_tail[b] = i;
+	}
+
+	ti->tgids = ti->indexed;
+}
+
+/*
+ *  Return the context_array index of a task, or -1 if it does not exist.
+ */
+static int task_index_lookup(ulong task)
+{
+	int i;
+
+	task_index_update();
+	ti->lookups++;
+
+	for (i = ti->task_head[task_index_hash(task)]; i != TASK_INDEX_END; i = ti->task_next[i]) {
+		if (tt->context_array[i].task == task)
+			return i;
+	}
+
+	return TASK_INDEX_END;
+}
+
+/*
+ *  Return the first task_context in the pid hash chain having a pid,
+ *  or the next one after tc.
+ */
+static struct task_context *next_pid_context(ulong pid, struct task_context *tc)
+{
+	int i;
+
+	if (tc)
+		i = ti->pid_next[tc - FIRST_CONTEXT()];
+	else {
+		task_index_update();
+		ti->lookups++;
+		i = ti->pid_head[task_index_hash(pid)];
+	}
+
+	for ( ; i != TASK_INDEX_END; i = ti->pid_next[i]) {
+		if (tt->context_array[i].pid == pid)
+			return &tt->context_array[i];
+	}
+
+	return NULL;
+}
+
+/*
+ *  Return the first task_context in array order belonging to a thread
+ *  group, or the next one after tc.
+ */
+static struct task_context *next_tgid_context(ulong tgid, struct task_context *tc)
+{
+	int i;
+
+	if (tc)
+		i = ti->tgid_next[tc - FIRST_CONTEXT()];
+	else {
+		task_index_tgids();
+		ti->lookups++;
+		i = ti->tgid_head[task_index_hash(tgid)];
+	}
+
+	for ( ; i != TASK_INDEX_END; i = ti->tgid_next[i]) {
+		if (ti->tgid[i] == tgid)
+			return &tt->context_array[i];
+	}
+
+	return NULL;
+}
+
 /*
  * Return the first task found that belongs to a pid.
  */
 ulong pid_to_task(ulong pid)
 {
-	int i;
 	struct task_context *tc;
 
-	tc = FIRST_CONTEXT();
-	for (i = 0; i < RUNNING_TASKS(); i++, tc++)
-		if (tc->pid == pid)
-			return (tc->task);
+	if ((tc = next_pid_context(pid, NULL)))
+		return (tc->task);
 
 	return ((ulong) NULL);
 }
@@ -3590,12 +3962,9 @@ ulong pid_to_task(ulong pid)
 ulong task_to_pid(ulong task)
 {
 	int i;
-	struct task_context *tc;
 
-	tc = FIRST_CONTEXT();
-	for (i = 0; i < RUNNING_TASKS(); i++, tc++)
-		if (tc->task == task)
-			return (tc->pid);
+	if ((i = task_index_lookup(task)) != TASK_INDEX_END)
+		return (tt->context_array[i].pid);
 
 	return (NO_PID);
 }
@@ -3605,15 +3974,7 @@ ulong task_to_pid(ulong task)
  */
 int task_exists(ulong task)
 {
-	int i;
-	struct task_context *tc;
-
-	tc = FIRST_CONTEXT();
-	for (i = 0; i < RUNNING_TASKS(); i++, tc++)
-		if (tc->task == task)
-			return TRUE;
-
-	return FALSE;
+	return (task_index_lookup(task) != TASK_INDEX_END);
 }
 
 /*
@@ -3622,12 +3983,9 @@ int task_exists(ulong task)
 struct task_context *task_to_context(ulong task)
 {
 	int i;
-	struct task_context *tc;
 
-	tc = FIRST_CONTEXT();
-	for (i = 0; i < RUNNING_TASKS(); i++, tc++)
-		if (tc->task == task)
-			return tc;
+	if ((i = task_index_lookup(task)) != TASK_INDEX_END)
+		return &tt->context_array[i];
 
 	return NULL;
 }
@@ -3637,14 +3995,10 @@ struct task_context *task_to_context(ulong task)
  */
 struct task_context *tgid_to_context(ulong parent_tgid)
 {
-	int i;
 	struct task_context *tc;
-	ulong tgid;
 
-	tc = FIRST_CONTEXT();
-	for (i = 0; i < RUNNING_TASKS(); i++, tc++) {
-		tgid = task_tgid(tc->task);
-		if ((tgid == parent_tgid) && (tgid == tc->pid))
+	for (tc = next_pid_context(parent_tgid, NULL); tc; tc = next_pid_context(parent_tgid, tc)) {
+		if (task_tgid(tc->task) == parent_tgid)
 			return tc;
 	}
 
@@ -3657,21 +4011,17 @@ struct task_context *tgid_to_context(ulong parent_tgid)
  */
 struct task_context *pid_to_context(ulong pid)
 {
-	int i;
 	struct task_context *tc, *firsttc, *lasttc;
 
-	tc = FIRST_CONTEXT();
 	firsttc = lasttc = NULL;
 
-	for (i = 0; i < RUNNING_TASKS(); i++, tc++) {
-		if (tc->pid == pid) {
-			if (!firsttc)
-				firsttc = tc;
-			if (lasttc)
-				lasttc->tc_next = tc;
-			tc->tc_next = NULL;
-			lasttc = tc;
-		}
+	for (tc = next_pid_context(pid, NULL); tc; tc = next_pid_context(pid, tc)) {
+		if (!firsttc)
+			firsttc = tc;
+		if (lasttc)
+			lasttc->tc_next = tc;
+		tc->tc_next = NULL;
+		lasttc = tc;
 	}
 
 	return firsttc;
@@ -3682,22 +4032,18 @@ struct task_context *pid_to_context(ulong pid)
  */
 int pid_exists(ulong pid)
 {
-	int i;
 	struct task_context *tc, *lasttc;
 	int count;
 
-	tc = FIRST_CONTEXT();
 	count = 0;
 	lasttc = NULL;
 
-	for (i = 0; i < RUNNING_TASKS(); i++, tc++) {
-		if (tc->pid == pid) {
-			count++;
-			if (lasttc)
-				lasttc->tc_next = tc;
-			tc->tc_next = NULL;
-			lasttc = tc;
-		}
+	for (tc = next_pid_context(pid, NULL); tc; tc = next_pid_context(pid, tc)) {
+		count++;
+		if (lasttc)
+			lasttc->tc_next = tc;
+		tc->tc_next = NULL;
+		lasttc = tc;
 	}
 
 	return (count);
@@ -4422,9 +4768,19 @@ ulong task_flags(ulong task)
 }
 
 /*
- *  Return a task's tgid.
+ *  Return a task's tgid, taken from the task index if it has been hashed.
  */
 ulong task_tgid(ulong task)
+{
+	int i;
+
+	if (ti->tgids && ((i = task_index_lookup(task)) != TASK_INDEX_END) && (i < ti->tgids))
+		return ti->tgid[i];
+
+	return read_task_tgid(task);
+}
+
+static ulong read_task_tgid(ulong task)
 {
 	uint tgid;
 
@@ -5903,7 +6259,14 @@ void dump_task_table(int verbose)
 	fprintf(fp, "      last_mm_read: %lx\n", tt->last_mm_read);
 	fprintf(fp, "       task_struct: %lx\n", (ulong) tt->task_struct);
 	fprintf(fp, "         mm_struct: %lx\n", (ulong) tt->mm_struct);
+	dump_task_object_cache(&task_struct_cache);
+	if (tt->flags & THREAD_INFO)
+		dump_task_object_cache(&thread_info_cache);
+	dump_task_object_cache(&mm_struct_cache);
 	fprintf(fp, "       init_pid_ns: %lx\n", tt->init_pid_ns);
+	fprintf(fp, "        task_index: %ld buckets, %ld indexed, %ld tgids\n",
+		ti->buckets, ti->indexed, ti->tgids);
+	fprintf(fp, "                    %ld builds, %ld lookups\n", ti->builds, ti->lookups);
 
 	wrap = sizeof(void *) == SIZEOF_32BIT ? 8 : 4;
 	flen = sizeof(void *) == SIZEOF_32BIT ? 8 : 16;
@@ -8059,7 +8422,6 @@ void cmd_sig(void)
  */
 static void do_sig_thread_group(ulong task)
 {
-	int i;
 	int cnt;
 	struct task_context *tc;
 	ulong tgid;
@@ -8085,19 +8447,16 @@ static void do_sig_thread_group(ulong task)
 	print_task_header(fp, tc, 0);
 	dump_signal_data(tc, TASK_LEVEL | TASK_INDENT);
 
-	tc = FIRST_CONTEXT();
-	for (i = cnt = 0; i < RUNNING_TASKS(); i++, tc++) {
+	for (cnt = 0, tc = next_tgid_context(tgid, NULL); tc; tc = next_tgid_context(tgid, tc)) {
 		if (tc->task == task)
 			continue;
 
-		if (task_tgid(tc->task) == tgid) {
-			fprintf(fp, "\n  ");
-			print_task_header(fp, tc, 0);
-			dump_signal_data(tc, TASK_LEVEL | TASK_INDENT);
-			cnt++;
-			if (tc->pid == 0)
-				pc->curcmd_flags |= IDLE_TASK_SHOWN;
-		}
+		fprintf(fp, "\n  ");
+		print_task_header(fp, tc, 0);
+		dump_signal_data(tc, TASK_LEVEL | TASK_INDENT);
+		cnt++;
+		if (tc->pid == 0)
+			pc->curcmd_flags |= IDLE_TASK_SHOWN;
 	}
 
 	fprintf(fp, "\n");
@@ -20,12 +20,11 @@
 
 static void print_number(struct number_option *, int, int);
 static long alloc_hq_entry(void);
-struct hq_entry;
-static void dealloc_hq_entry(struct hq_entry *);
+static ulong hq_search(ulong);
 static void show_options(void);
 static void dump_struct_members(struct list_data *, int, ulong);
 static void rbtree_iteration(ulong, struct tree_data *, char *);
-static void rdtree_iteration(ulong, struct tree_data *, char *, ulong, uint);
+static int rdtree_entry(ulong, ulong, void *);
 static void dump_struct_members_for_tree(struct tree_data *, int, ulong);
 
 /*
@@ -2272,6 +2271,7 @@ void cmd_set(void)
 					}
 				} else
 					goto invalid_set_command;
+				dump_page_cache_flush();
 			}
 
 			if (runtime)
@@ -2279,6 +2279,34 @@ void cmd_set(void)
 					(*diskdump_flags & ZERO_EXCLUDED) || sadump_is_zero_excluded()? "on" : "off");
 			return;
 
+		} else if (STREQ(args[optind], "page_cache")) {
+
+			if (args[optind + 1]) {
+				optind++;
+				if (from_rc_file)
+					already_done();
+				else
+					set_dump_page_cache(args[optind]);
+			}
+
+			if (runtime)
+				fprintf(fp, "page_cache: %ld\n", get_dump_page_cache());
+			return;
+
+		} else if (STREQ(args[optind], "dump_threads")) {
+
+			if (args[optind + 1]) {
+				optind++;
+				if (from_rc_file)
+					already_done();
+				else
+					set_diskdump_threads(args[optind]);
+			}
+
+			if (runtime)
+				fprintf(fp, "dump_threads: %d\n", get_diskdump_threads());
+			return;
+
 		} else if (XEN_HYPER_MODE()) {
 			error(FATAL, "invalid argument for the Xen hypervisor\n");
 		} else if (pc->flags & MINIMAL_MODE) {
@@ -2367,6 +2395,8 @@ static void show_options(void)
 	fprintf(fp, "      dumpfile: %s\n", pc->dumpfile);
 	fprintf(fp, "        unwind: %s\n", kt->flags & DWARF_UNWIND ? "on" : "off");
 	fprintf(fp, " zero_excluded: %s\n", *diskdump_flags & ZERO_EXCLUDED ? "on" : "off");
+	fprintf(fp, "    page_cache: %ld\n", get_dump_page_cache());
+	fprintf(fp, "  dump_threads: %d\n", get_diskdump_threads());
 	fprintf(fp, "     null-stop: %s\n", *gdb_stop_print_at_null ? "on" : "off");
 	fprintf(fp, "           gdb: %s\n", pc->flags2 & GDB_CMD_MODE ? "on" : "off");
 	fprintf(fp, "         scope: %lx ", pc->scope);
@@ -3251,6 +3281,69 @@ void cmd_list(void)
 		FREEBUF(ld->structname);
 }
 
+/*
+ *  A small window of recently-read kernel virtual pages, used by the list
+ *  and tree walkers to fetch node pointers.  Consecutive nodes that sit
+ *  on the same page then cost one translation and one dumpfile read for
+ *  the page, instead of one of each per pointer.  The window is emptied
+ *  at the start of each walk.  Reads that cross a page, and pages that
+ *  cannot be read in whole, fall back to a plain readmem().
+ */
+#define NODE_WINDOW_PAGES  (8)
+
+static struct node_window {
+	int next;		/* next slot to replace */
+	struct {
+		ulong vaddr;	/* page base, or 0 if unused */
+		char *buf;
+	} page[NODE_WINDOW_PAGES];
+} node_window = { 0 };
+
+static void node_window_clear(void)
+{
+	int i;
+
+	for (i = 0; i < NODE_WINDOW_PAGES; i++)
+		node_window.page[i].vaddr = 0;
+	node_window.next = 0;
+}
+
+static int read_node(ulong addr, void *buffer, long size, char *type, ulong error_handle)
+{
+	int i;
+	ulong page;
+	char *buf;
+
+	if ((PAGEOFFSET(addr) + size) > PAGESIZE())
+		return readmem(addr, KVADDR, buffer, size, type, error_handle);
+
+	page = VIRTPAGEBASE(addr);
+
+	for (i = 0; i < NODE_WINDOW_PAGES; i++) {
+		if (node_window.page[i].vaddr && (node_window.page[i].vaddr == page)) {
+			BCOPY(node_window.page[i].buf + PAGEOFFSET(addr), buffer, size);
+			return TRUE;
+		}
+	}
+
+	i = node_window.next;
+	node_window.next = (i + 1) % NODE_WINDOW_PAGES;
+
+	if (!(buf = node_window.page[i].buf) &&
+	    !(buf = node_window.page[i].buf = malloc(PAGESIZE())))
+		return readmem(addr, KVADDR, buffer, size, type, error_handle);
+
+	if (!readmem(page, KVADDR, buf, PAGESIZE(), type, RETURN_ON_ERROR|QUIET)) {
+		node_window.page[i].vaddr = 0;
+		return readmem(addr, KVADDR, buffer, size, type, error_handle);
+	}
+
+	node_window.page[i].vaddr = page;
+	BCOPY(buf + PAGEOFFSET(addr), buffer, size);
+
+	return TRUE;
+}
+
 /*
  *  Does the work for cmd_list() and any other function that requires the
  *  contents of a linked list.  See cmd_list description above for details.
@@ -3312,7 +3405,9 @@ int do_list(struct list_data *ld)
 
 	readflag = ld->flags & RETURN_ON_LIST_ERROR ? (RETURN_ON_ERROR | QUIET) : FAULT_ON_ERROR;
 
-	if (!readmem(next + ld->member_offset, KVADDR, &first, sizeof(void *), "first list entry", readflag)) {
+	node_window_clear();
+
+	if (!read_node(next + ld->member_offset, &first, sizeof(void *), "first list entry", readflag)) {
 		error(INFO, "\ninvalid list entry: %lx\n", next);
 		return -1;
 	}
@@ -3355,7 +3450,7 @@ int do_list(struct list_data *ld)
 		count++;
 		last = next;
 
-		if (!readmem(next + ld->member_offset, KVADDR, &next, sizeof(void *), "list entry", readflag)) {
+		if (!read_node(next + ld->member_offset, &next, sizeof(void *), "list entry", readflag)) {
 			error(INFO, "\ninvalid list entry: %lx\n", next);
 			return -1;
 		}
@@ -3631,16 +3726,19 @@ void cmd_tree()
 		FREEBUF(td->structname);
 }
 
-static ulong RADIX_TREE_MAP_SHIFT = UNINITIALIZED;
-static ulong RADIX_TREE_MAP_SIZE = UNINITIALIZED;
-static ulong RADIX_TREE_MAP_MASK = UNINITIALIZED;
+/*
+ *  State shared by do_rdtree() with its rdtree_entry() callback.
+ */
+struct rdtree_info {
+	struct tree_data *td;
+	uint height;
+};
 
 int do_rdtree(struct tree_data *td)
 {
-	long nlen;
 	ulong node_p;
 	uint print_radix, height;
-	char pos[BUFSIZE];
+	struct rdtree_info ri;
 
 	if (!VALID_STRUCT(radix_tree_root) || !VALID_STRUCT(radix_tree_node) ||
 	    !VALID_MEMBER(radix_tree_root_height) ||
@@ -3648,14 +3746,7 @@ int do_rdtree(struct tree_data *td)
 	    !VALID_MEMBER(radix_tree_node_slots) || !ARRAY_LENGTH(height_to_maxindex))
 		error(FATAL, "radix trees do not exist or have changed " "their format\n");
 
-	if (RADIX_TREE_MAP_SHIFT == UNINITIALIZED) {
-		if (!(nlen = MEMBER_SIZE("radix_tree_node", "slots")))
-			error(FATAL, "cannot determine length of " "radix_tree_node.slots[] array\n");
-		nlen /= sizeof(void *);
-		RADIX_TREE_MAP_SHIFT = ffsl(nlen) - 1;
-		RADIX_TREE_MAP_SIZE = (1UL << RADIX_TREE_MAP_SHIFT);
-		RADIX_TREE_MAP_MASK = (RADIX_TREE_MAP_SIZE - 1);
-	}
+	radix_tree_init();
 
 	if (td->flags & TREE_STRUCT_RADIX_10)
 		print_radix = 10;
@@ -3703,67 +3794,64 @@ int do_rdtree(struct tree_data *td)
 	if (node_p & 1)
 		node_p &= ~1;
 
-	sprintf(pos, "root");
+	ri.td = td;
+	ri.height = height;
 
-	rdtree_iteration(node_p, td, pos, -1, height);
+	radix_tree_walk(node_p, height, rdtree_entry, &ri);
 
 	return td->count;
 }
 
-void rdtree_iteration(ulong node_p, struct tree_data *td, char *ppos, ulong indexnum, uint height)
+/*
+ *  radix_tree_walk() callback for each entry of a "tree -t radix" walk.
+ */
+static int rdtree_entry(ulong index, ulong slot, void *arg)
 {
-	ulong slot;
-	int i, index;
+	struct rdtree_info *ri = (struct rdtree_info *)arg;
+	struct tree_data *td = ri->td;
+	int i, level;
 	uint print_radix;
 	char pos[BUFSIZE];
 
-	if (indexnum != -1)
-		sprintf(pos, "%s/%ld", ppos, indexnum);
+	if (hq_enter(slot))
+		td->count++;
 	else
-		sprintf(pos, "%s", ppos);
-
-	for (index = 0; index < RADIX_TREE_MAP_SIZE; index++) {
-		readmem((ulong) node_p + OFFSET(radix_tree_node_slots) +
-			sizeof(void *) * index, KVADDR, &slot, sizeof(void *),
-			"radix_tree_node.slot[index]", FAULT_ON_ERROR);
-		if (!slot)
-			continue;
-		if (height == 1) {
-			if (hq_enter(slot))
-				td->count++;
-			else
-				error(FATAL, "\nduplicate tree entry: %lx\n", node_p);
+		error(FATAL, "\nduplicate tree entry: %lx\n", slot);
 
-			if (td->flags & VERBOSE)
-				fprintf(fp, "%lx\n", slot);
+	if (td->flags & VERBOSE)
+		fprintf(fp, "%lx\n", slot);
 
-			if (td->flags & TREE_POSITION_DISPLAY)
-				fprintf(fp, "  position: %s/%d\n", pos, index);
+	if (td->flags & TREE_POSITION_DISPLAY) {
+		sprintf(pos, "root");
+		for (level = ri->height; level > 0; level--)
+			sprintf(&pos[strlen(pos)], "/%ld", (index >>
+				((level - 1) * RADIX_TREE_MAP_SHIFT)) & RADIX_TREE_MAP_MASK);
+		fprintf(fp, "  position: %s\n", pos);
+	}
 
-			if (td->structname) {
-				if (td->flags & TREE_STRUCT_RADIX_10)
-					print_radix = 10;
-				else if (td->flags & TREE_STRUCT_RADIX_16)
-					print_radix = 16;
-				else
-					print_radix = 0;
+	if (td->structname) {
+		if (td->flags & TREE_STRUCT_RADIX_10)
+			print_radix = 10;
+		else if (td->flags & TREE_STRUCT_RADIX_16)
+			print_radix = 16;
+		else
+			print_radix = 0;
 
-				for (i = 0; i < td->structname_args; i++) {
-					switch (count_chars(td->structname[i], '.')) {
-					case 0:
-						dump_struct(td->structname[i], slot, print_radix);
-						break;
-					case 1:
-						dump_struct_members_for_tree(td, i, slot);
-						break;
-					default:
-						error(FATAL, "invalid struct reference: %s\n", td->structname[i]);
-					}
-				}
+		for (i = 0; i < td->structname_args; i++) {
+			switch (count_chars(td->structname[i], '.')) {
+			case 0:
+				dump_struct(td->structname[i], slot, print_radix);
+				break;
+			case 1:
+				dump_struct_members_for_tree(td, i, slot);
+				break;
+			default:
+				error(FATAL, "invalid struct reference: %s\n", td->structname[i]);
 			}
-		} else
-			rdtree_iteration(slot, td, pos, index, height - 1);
+		}
 	}
+
+	return TRUE;
 }
 
 int do_rbtree(struct tree_data *td)
@@ -3782,6 +3870,8 @@ int do_rbtree(struct tree_data *td)
 		readmem(td->start + OFFSET(rb_root_rb_node), KVADDR,
 			&start, sizeof(void *), "rb_root rb_node", FAULT_ON_ERROR);
 
+	node_window_clear();
+
 	rbtree_iteration(start, td, pos);
 
 	return td->count;
@@ -3832,9 +3922,8 @@ void rbtree_iteration(ulong node_p, struct tree_data *td, char *pos)
 		}
 	}
 
-	readmem(node_p + OFFSET(rb_node_rb_left), KVADDR, &left_p, sizeof(void *), "rb_node rb_left", FAULT_ON_ERROR);
-	readmem(node_p + OFFSET(rb_node_rb_right), KVADDR, &right_p,
-		sizeof(void *), "rb_node rb_right", FAULT_ON_ERROR);
+	read_node(node_p + OFFSET(rb_node_rb_left), &left_p, sizeof(void *), "rb_node rb_left", FAULT_ON_ERROR);
+	read_node(node_p + OFFSET(rb_node_rb_right), &right_p, sizeof(void *), "rb_node rb_right", FAULT_ON_ERROR);
 
 	sprintf(left_pos, "%s/l", pos);
 	sprintf(right_pos, "%s/r", pos);
@@ -3901,32 +3990,34 @@ void dump_struct_members_for_tree(struct tree_data *td, int idx, ulong struct_p)
 #define HASH_QUEUE_OPEN       (0x4)
 #define HASH_QUEUE_CLOSED     (0x8)
 
+/*
+ *  The entered values are stored in memptr[1] through memptr[index] in
+ *  the order they were entered.  They are indexed by an open-addressed
+ *  table of memptr positions, where 0 marks an empty slot, searched with
+ *  linear probing from a Fibonacci hash of the value.  The table is kept
+ *  at most half full, and both arrays double in size as needed.
+ */
 #define HQ_ENTRY_CHUNK   (1024)
-#define NR_HASH_QUEUES   (HQ_ENTRY_CHUNK/8)
-#define HQ_SHIFT         (machdep->pageshift)
-#define HQ_INDEX(X)      (((X) >> HQ_SHIFT) % NR_HASH_QUEUES)
-
-struct hq_entry {
-	int next;
-	int order;
-	ulong value;
-};
-
-struct hq_head {
-	int next;
-	int qcnt;
-};
+#define HQ_MIN_SLOTS     (HQ_ENTRY_CHUNK*2)
+#define HQ_INDEX(X, HT)  ((ulong)(((ulonglong)(X) * 0x9e3779b97f4a7c15ULL) >> (HT)->hash_shift))
 
 struct hash_table {
 	ulong flags;
-	struct hq_head queue_heads[NR_HASH_QUEUES];
-	struct hq_entry *memptr;
-	long count;
-	long index;
+	ulong *memptr;		/* entered values, starting at memptr[1] */
+	long count;		/* size of memptr */
+	long index;		/* last used memptr entry */
 	int reallocs;
+	uint *slots;		/* memptr positions, or 0 */
+	long nr_slots;		/* power of 2 */
+	int hash_shift;		/* 64 - log2(nr_slots) */
+	ulong searches;		/* statistics for this session */
+	ulong probes;
+	ulong max_probes;
 } hash_table = {
 0};
 
+static int hq_alloc_slots(long);
+
 /*
  *  For starters, allocate a hash table containing HQ_ENTRY_CHUNK entries.
  *  If necessary during runtime, it will be increased in size.
@@ -3937,63 +4028,108 @@ void hq_init(void)
 
 	ht = &hash_table;
 
-	if ((ht->memptr = (struct hq_entry *)malloc(HQ_ENTRY_CHUNK * sizeof(struct hq_entry)))
-	    == NULL) {
+	if (((ht->memptr = (ulong *)malloc(HQ_ENTRY_CHUNK * sizeof(ulong))) == NULL) ||
+	    !hq_alloc_slots(HQ_MIN_SLOTS)) {
 		error(INFO, "cannot malloc memory for hash queues: %s\n", strerror(errno));
 		ht->flags = HASH_QUEUE_NONE;
 		pc->flags &= ~HASH;
 		return;
 	}
 
-	BZERO(ht->memptr, HQ_ENTRY_CHUNK * sizeof(struct hq_entry));
 	ht->count = HQ_ENTRY_CHUNK;
 	ht->index = 0;
 }
 
 /*
- *  Get a free hash queue entry.  If there's no more available, realloc()
- *  a new chunk of memory with another HQ_ENTRY_CHUNK entries stuck on the end.
+ *  Replace the slot table with an empty one of nr_slots entries, and
+ *  re-index any values already entered.
+ */
+static int hq_alloc_slots(long nr_slots)
+{
+	struct hash_table *ht;
+	uint *slots;
+	long i;
+	ulong s, mask;
+	int bits;
+
+	ht = &hash_table;
+
+	if ((slots = (uint *)calloc(nr_slots, sizeof(uint))) == NULL)
+		return FALSE;
+
+	if (ht->slots)
+		ht->reallocs++;
+	free(ht->slots);
+	ht->slots = slots;
+	ht->nr_slots = nr_slots;
+	for (bits = 0; (1L << bits) < nr_slots; bits++) ;
+	ht->hash_shift = 64 - bits;
+
+	mask = nr_slots - 1;
+	for (i = 1; i <= ht->index; i++) {
+		for (s = HQ_INDEX(ht->memptr[i], ht); slots[s]; s = (s + 1) & mask) ;
+		slots[s] = i;
+	}
+
+	return TRUE;
+}
+
+/*
+ *  Get a free hash queue entry, growing the value array and the slot
+ *  table if necessary.
  */
 static long alloc_hq_entry(void)
 {
 	struct hash_table *ht;
-	struct hq_entry *new, *end_of_old;
+	ulong *new;
 
 	ht = &hash_table;
 
-	if (++ht->index == ht->count) {
-		if (!(new = (void *)realloc((void *)ht->memptr,
-					    (ht->count + HQ_ENTRY_CHUNK) * sizeof(struct hq_entry)))) {
+	if ((ht->index + 1) == ht->count) {
+		if (!(new = (ulong *)realloc((void *)ht->memptr, ht->count * 2 * sizeof(ulong)))) {
 			error(INFO, "cannot realloc memory for hash queues: %s\n", strerror(errno));
 			ht->flags |= HASH_QUEUE_FULL;
 			return (-1);
 		}
 		ht->reallocs++;
 		ht->memptr = new;
-		end_of_old = ht->memptr + ht->count;
-		BZERO(end_of_old, HQ_ENTRY_CHUNK * sizeof(struct hq_entry));
-		ht->count += HQ_ENTRY_CHUNK;
+		ht->count *= 2;
 	}
 
-	return (ht->index);
+	if (((ht->index + 1) * 2) > ht->nr_slots) {
+		if (!hq_alloc_slots(ht->nr_slots * 2)) {
+			error(INFO, "cannot realloc memory for hash queues: %s\n", strerror(errno));
+			ht->flags |= HASH_QUEUE_FULL;
+			return (-1);
+		}
+	}
+
+	return (++ht->index);
 }
 
 /*
- *  Restore the hash queue to its state before the duplicate entry
- *  was attempted.
+ *  Return the slot that holds a value, or the empty slot where it
+ *  would go.
  */
-static void dealloc_hq_entry(struct hq_entry *entry)
+static ulong hq_search(ulong value)
 {
 	struct hash_table *ht;
-	long hqi;
+	ulong s, mask, probes;
 
 	ht = &hash_table;
-	hqi = HQ_INDEX(entry->value);
+	mask = ht->nr_slots - 1;
 
-	ht->index--;
+	for (s = HQ_INDEX(value, ht), probes = 1; ht->slots[s]; s = (s + 1) & mask, probes++) {
+		if (ht->memptr[ht->slots[s]] == value)
+			break;
+	}
 
-	BZERO(entry, sizeof(struct hq_entry));
-	ht->queue_heads[hqi].qcnt--;
+	ht->searches++;
+	ht->probes += probes;
+	if (probes > ht->max_probes)
+		ht->max_probes = probes;
+
+	return s;
 }
 
 /*
@@ -4002,6 +4138,8 @@ static void dealloc_hq_entry(struct hq_entry *entry)
 int hq_open(void)
 {
 	struct hash_table *ht;
+	long i;
+	ulong s;
 
 	if (!(pc->flags & HASH))
 		return FALSE;
@@ -4011,9 +4149,21 @@ int hq_open(void)
 		return FALSE;
 
 	ht->flags &= ~(HASH_QUEUE_FULL | HASH_QUEUE_CLOSED);
-	BZERO(ht->queue_heads, sizeof(struct hq_head) * NR_HASH_QUEUES);
-	BZERO(ht->memptr, ht->count * sizeof(struct hq_entry));
+
+	/*
+	 *  Unless the last session filled a good part of the slot table,
+	 *  it's cheaper to clear just the slots that it used.
+	 */
+	if ((ht->index * 8) < ht->nr_slots) {
+		for (i = 1; i <= ht->index; i++) {
+			for (s = HQ_INDEX(ht->memptr[i], ht); ht->slots[s] != i; s = (s + 1) & (ht->nr_slots - 1)) ;
+			ht->slots[s] = 0;
+		}
+	} else
+		BZERO(ht->slots, ht->nr_slots * sizeof(uint));
+
 	ht->index = 0;
+	ht->searches = ht->probes = ht->max_probes = 0;
 
 	ht->flags |= HASH_QUEUE_OPEN;
 
@@ -4043,8 +4193,6 @@ int hq_close(void)
 	return (ht->index);
 }
 
-char *corrupt_hq = "corrupt hash queue entry: value: %lx next: %d order: %d\n";
-
 /*
  *  For a given value, allocate a hash queue entry and hash it into the
  *  open hash table.  If a duplicate entry is found, return FALSE; for all
@@ -4054,10 +4202,8 @@ char *corrupt_hq = "corrupt hash queue entry: value: %lx next: %d order: %d\n";
 int hq_enter(ulong value)
 {
 	struct hash_table *ht;
-	struct hq_entry *entry;
-	struct hq_entry *list_entry;
-	long hqi;
 	long index;
+	ulong s;
 
 	if (!(pc->flags & HASH))
 		return TRUE;
@@ -4070,50 +4216,19 @@ int hq_enter(ulong value)
 	if (!(ht->flags & HASH_QUEUE_OPEN))
 		return TRUE;
 
-	if ((index = alloc_hq_entry()) < 0)
-		return TRUE;
-
-	entry = ht->memptr + index;
-	if (entry->next || entry->value || entry->order) {
-		error(INFO, corrupt_hq, entry->value, entry->next, entry->order);
-		ht->flags |= HASH_QUEUE_NONE;
-		return TRUE;
-	}
-
-	entry->next = 0;
-	entry->value = value;
-	entry->order = index;
-
-	hqi = HQ_INDEX(value);
+	if (ht->slots[hq_search(value)])
+		return FALSE;
 
-	if (ht->queue_heads[hqi].next == 0) {
-		ht->queue_heads[hqi].next = index;
-		ht->queue_heads[hqi].qcnt = 1;
+	if ((index = alloc_hq_entry()) < 0)
 		return TRUE;
-	} else
-		ht->queue_heads[hqi].qcnt++;
-
-	list_entry = ht->memptr + ht->queue_heads[hqi].next;
 
-	while (TRUE) {
-		if (list_entry->value == entry->value) {
-			dealloc_hq_entry(entry);
-			return FALSE;
-		}
+	ht->memptr[index] = value;
 
-		if (list_entry->next >= ht->count) {
-			error(INFO, corrupt_hq, list_entry->value, list_entry->next, list_entry->order);
-			ht->flags |= HASH_QUEUE_NONE;
-			return TRUE;
-		}
-
-		if (list_entry->next == 0)
-			break;
-
-		list_entry = ht->memptr + list_entry->next;
-	}
-
-	list_entry->next = index;
+	/*
+	 *  The slot table may have been resized.
+	 */
+	for (s = HQ_INDEX(value, ht); ht->slots[s]; s = (s + 1) & (ht->nr_slots - 1)) ;
+	ht->slots[s] = index;
 
 	return TRUE;
 }
@@ -4123,13 +4238,9 @@ int hq_enter(ulong value)
  */
 void dump_hash_table(int verbose)
 {
-	int i;
+	long i;
 	struct hash_table *ht;
-	struct hq_entry *list_entry;
-	long elements;
-	long queues_in_use;
 	int others;
-	uint minq, maxq;
 
 	ht = &hash_table;
 	others = 0;
@@ -4144,74 +4255,30 @@ void dump_hash_table(int verbose)
 	if (ht->flags & HASH_QUEUE_FULL)
 		fprintf(fp, "%sHASH_QUEUE_FULL", others++ ? "|" : "");
 	fprintf(fp, ")\n");
-	fprintf(fp, "   queue_heads[%d]: %lx\n", NR_HASH_QUEUES, (ulong) ht->queue_heads);
 	fprintf(fp, "             memptr: %lx\n", (ulong) ht->memptr);
 	fprintf(fp, "              count: %ld  ", ht->count);
 	if (ht->reallocs)
 		fprintf(fp, "  (%d reallocs)", ht->reallocs);
 	fprintf(fp, "\n");
 	fprintf(fp, "              index: %ld\n", ht->index);
-
-	queues_in_use = 0;
-	minq = ~(0);
-	maxq = 0;
-
-	for (i = 0; i < NR_HASH_QUEUES; i++) {
-		if (ht->queue_heads[i].next == 0) {
-			minq = 0;
-			continue;
-		}
-
-		if (ht->queue_heads[i].qcnt < minq)
-			minq = ht->queue_heads[i].qcnt;
-		if (ht->queue_heads[i].qcnt > maxq)
-			maxq = ht->queue_heads[i].qcnt;
-
-		queues_in_use++;
-	}
-
-	elements = 0;
-	list_entry = ht->memptr;
-	for (i = 0; i < ht->count; i++, list_entry++) {
-		if (!list_entry->order) {
-			if (list_entry->value || list_entry->next)
-				goto corrupt_list_entry;
-			continue;
-		}
-
-		if (list_entry->next >= ht->count)
-			goto corrupt_list_entry;
-
-		++elements;
-	}
-
-	if (elements != ht->index)
-		fprintf(fp, "     elements found: %ld (expected %ld)\n", elements, ht->index);
-	fprintf(fp, "      queues in use: %ld of %d\n", queues_in_use, NR_HASH_QUEUES);
-	fprintf(fp, " queue length range: %d to %d\n", minq, maxq);
+	fprintf(fp, "              slots: %lx\n", (ulong) ht->slots);
+	fprintf(fp, "           nr_slots: %ld\n", ht->nr_slots);
+	fprintf(fp, "        load factor: %ld%%\n", ht->nr_slots ? (ht->index * 100) / ht->nr_slots : 0);
+	fprintf(fp, "           searches: %ld\n", ht->searches);
+	fprintf(fp, "             probes: %ld  (avg: %.2f  max: %ld)\n", ht->probes,
+		ht->searches ? (double)ht->probes / (double)ht->searches : 0.0, ht->max_probes);
 
 	if (verbose) {
-		if (!elements) {
+		if (!ht->index) {
 			fprintf(fp, "            entries: (none)\n");
 			return;
 		}
 
 		fprintf(fp, "            entries: ");
 
-		list_entry = ht->memptr;
-		for (i = 0; i < ht->count; i++, list_entry++) {
-			if (list_entry->order)
-				fprintf(fp, "%s%lx (%d)\n",
-					list_entry->order == 1 ?
-					"" : "                     ", list_entry->value, list_entry->order);
-		}
+		for (i = 1; i <= ht->index; i++)
+			fprintf(fp, "%s%lx (%ld)\n", i == 1 ? "" : "                     ", ht->memptr[i], i);
 	}
-	return;
-
- corrupt_list_entry:
-
-	error(INFO, corrupt_hq, list_entry->value, list_entry->next, list_entry->order);
-	ht->flags |= HASH_QUEUE_NONE;
 }
 
 /*
@@ -4219,15 +4286,11 @@ void dump_hash_table(int verbose)
  *  the current hash table entries.  The entries will be sorted according
  *  to the order in which they were entered, so from this point on, no
  *  further hq_enter() operations on this list will be allowed.  However,
- *  multiple calls to retrieve_list are allowed because the second and
- *  subsequent ones will go directly to where the non-zero (valid) entries
- *  start in the potentially very large list_entry memory chunk.
+ *  multiple calls to retrieve_list are allowed.
  */
 int retrieve_list(ulong array[], int count)
 {
-	int i;
 	struct hash_table *ht;
-	struct hq_entry *list_entry;
 	int elements;
 
 	if (!(pc->flags & HASH))
@@ -4235,31 +4298,15 @@ int retrieve_list(ulong array[], int count)
 
 	ht = &hash_table;
 
-	list_entry = ht->memptr;
-	for (i = elements = 0; i < ht->count; i++, list_entry++) {
-		if (!list_entry->order) {
-			if (list_entry->value || list_entry->next)
-				goto corrupt_list_entry;
-			continue;
-		}
-
-		if (list_entry->next >= ht->count)
-			goto corrupt_list_entry;
+	if (ht->flags & HASH_QUEUE_NONE)
+		return (-1);
 
-		if (array)
-			array[elements] = list_entry->value;
+	elements = (count > 0) ? MIN(ht->index, (long)count) : ht->index;
 
-		if (++elements == count)
-			break;
-	}
+	if (array)
+		BCOPY(&ht->memptr[1], array, elements * sizeof(ulong));
 
 	return elements;
-
- corrupt_list_entry:
-
-	error(INFO, corrupt_hq, list_entry->value, list_entry->next, list_entry->order);
-	ht->flags |= HASH_QUEUE_NONE;
-	return (-1);
 }
 
 /*
@@ -4269,8 +4316,6 @@ int retrieve_list(ulong array[], int count)
 int hq_entry_exists(ulong value)
 {
 	struct hash_table *ht;
-	struct hq_entry *list_entry;
-	long hqi;
 
 	if (!(pc->flags & HASH))
 		return FALSE;
@@ -4283,26 +4328,7 @@ int hq_entry_exists(ulong value)
 	if (!(ht->flags & HASH_QUEUE_OPEN))
 		return FALSE;
 
-	hqi = HQ_INDEX(value);
-	list_entry = ht->memptr + ht->queue_heads[hqi].next;
-
-	while (TRUE) {
-		if (list_entry->value == value)
-			return TRUE;
-
-		if (list_entry->next >= ht->count) {
-			error(INFO, corrupt_hq, list_entry->value, list_entry->next, list_entry->order);
-			ht->flags |= HASH_QUEUE_NONE;
-			return FALSE;
-		}
-
-		if (list_entry->next == 0)
-			break;
-
-		list_entry = ht->memptr + list_entry->next;
-	}
-
-	return FALSE;
+	return (ht->slots[hq_search(value)] ? TRUE : FALSE);
 }
 
 /*
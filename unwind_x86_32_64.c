@@ -35,6 +35,11 @@ static struct local_unwind_table {
 	} core, init;
 	void *address;
 	unsigned long size;
+	struct fde_index_entry *fde_index;
+	int fde_cnt;
+	struct cie_info *cie_info;
+	int cie_cnt;
+	int indexed;
 } *local_unwind_tables, default_unwind_table;
 
 static int gather_in_memory_unwind_tables(void);
@@ -42,6 +47,9 @@ static int populate_local_tables(ulong, char *);
 static int unwind_tables_cnt = 0;
 static struct local_unwind_table *find_table(unsigned long);
 static void dump_local_unwind_tables(void);
+static void index_unwind_tables(void);
+static int build_fde_index(struct local_unwind_table *, int);
+static struct fde_index_entry *lookup_fde(struct local_unwind_table *, unsigned long);
 
 static const struct {
 	unsigned offs:BITS_PER_LONG / 2;
@@ -143,6 +151,34 @@ struct unwind_state {
 	const u8 *stack[MAX_STACK_DEPTH];
 };
 
+/*
+ *  Each unwind table gets a copy of its FDE locations sorted by start
+ *  address, so that unwind() can find the FDE for a pc with a binary
+ *  search instead of walking the whole table.  maxEnd is the highest
+ *  endLoc of the entry and all entries before it, which bounds the
+ *  backward search for overlapping FDEs.  The CIEs are decoded once
+ *  as the index is built.
+ */
+struct cie_info {
+	const u32 *cie;
+	signed ptrType;
+	int valid;
+	unsigned version;
+	uleb128_t codeAlign;
+	sleb128_t dataAlign;
+	uleb128_t retAddrReg;
+	const u8 *cieStart, *cieEnd;
+};
+
+struct fde_index_entry {
+	unsigned long startLoc;
+	unsigned long endLoc;
+	unsigned long maxEnd;
+	const u32 *fde;
+	const u8 *instructions;	/* past the pc range */
+	int cie;		/* index into cie_info[] */
+};
+
 static const struct cfa badCFA = { ARRAY_SIZE(reg_info), 1 };
 
 static uleb128_t get_uleb128(const u8 ** pcur, const u8 * end)
@@ -482,101 +518,36 @@ int unwind(struct unwind_frame_info *frame, int is_ehframe)
 	unsigned i;
 	signed ptrType = -1;
 	uleb128_t retAddrReg = 0;
-//      struct unwind_table *table;
-	void *unwind_table;
 	struct local_unwind_table *table;
+	struct fde_index_entry *entry = NULL;
+	struct cie_info *ci = NULL;
 	struct unwind_state state;
 	u64 reg_ptr = 0;
 
 	if (UNW_PC(frame) == 0)
 		return -EINVAL;
 
-	if ((table = find_table(UNW_PC(frame)))) {
-//              unsigned long tableSize = unwind_table_size;
-		unsigned long tableSize = table->size;
-
-		unwind_table = table->address;
-
-		for (fde = unwind_table; tableSize > sizeof(*fde)
-		     && tableSize - sizeof(*fde) >= *fde;
-		     tableSize -= sizeof(*fde) + *fde, fde += 1 + *fde / sizeof(*fde)) {
-			if (!*fde || (*fde & (sizeof(*fde) - 1)))
-				break;
-			if (is_ehframe && !fde[1])
-				continue;	/* this is a CIE */
-			else if (fde[1] == 0xffffffff)
-				continue;	/* this is a CIE */
-			if ((fde[1] & (sizeof(*fde) - 1))
-			    || fde[1] > (unsigned long)(fde + 1)
-			    - (unsigned long)unwind_table)
-				continue;	/* this is not a valid FDE */
-			if (is_ehframe)
-				cie = fde + 1 - fde[1] / sizeof(*fde);
-			else
-				cie = unwind_table + fde[1];
-			if (*cie <= sizeof(*cie) + 4 || *cie >= fde[1] - sizeof(*fde)
-			    || (*cie & (sizeof(*cie) - 1))
-			    || (cie[1] != 0xffffffff && cie[1])
-			    || (ptrType = fde_pointer_type(cie)) < 0) {
-				cie = NULL;	/* this is not a (valid) CIE */
-				continue;
-			}
-			ptr = (const u8 *)(fde + 2);
-			startLoc = read_pointer(&ptr, (const u8 *)(fde + 1) + *fde, ptrType);
-			endLoc =
-			    startLoc + read_pointer(&ptr,
-						    (const u8 *)(fde + 1) +
-						    *fde,
-						    ptrType & DW_EH_PE_indirect
-						    ? ptrType : ptrType & (DW_EH_PE_FORM | DW_EH_PE_signed));
-			if (UNW_PC(frame) >= startLoc && UNW_PC(frame) < endLoc)
-				break;
-			cie = NULL;
+	if ((table = find_table(UNW_PC(frame))) &&
+	    build_fde_index(table, is_ehframe) &&
+	    (entry = lookup_fde(table, UNW_PC(frame)))) {
+		ci = &table->cie_info[entry->cie];
+		if (ci->valid) {
+			fde = entry->fde;
+			cie = ci->cie;
+			ptrType = ci->ptrType;
+			startLoc = entry->startLoc;
+			endLoc = entry->endLoc;
 		}
 	}
 	if (cie != NULL) {
 		memset(&state, 0, sizeof(state));
-		state.cieEnd = ptr;	/* keep here temporarily */
-		ptr = (const u8 *)(cie + 2);
-		end = (const u8 *)(cie + 1) + *cie;
-		if ((state.version = *ptr) != 1)
-			cie = NULL;	/* unsupported version */
-		else if (*++ptr) {
-			/* check if augmentation size is first (and thus present) */
-			if (*ptr == 'z') {
-				/* check for ignorable (or already handled)
-				 * nul-terminated augmentation string */
-				while (++ptr < end && *ptr)
-					if (strchr("LPR", *ptr) == NULL)
-						break;
-			}
-			if (ptr >= end || *ptr)
-				cie = NULL;
-		}
-		++ptr;
-	}
-	if (cie != NULL) {
-		/* get code aligment factor */
-		state.codeAlign = get_uleb128(&ptr, end);
-		/* get data aligment factor */
-		state.dataAlign = get_sleb128(&ptr, end);
-		if (state.codeAlign == 0 || state.dataAlign == 0 || ptr >= end)
-			cie = NULL;
-		else {
-			retAddrReg = state.version <= 1 ? *ptr++ : get_uleb128(&ptr, end);
-			/* skip augmentation */
-			if (((const char *)(cie + 2))[1] == 'z')
-				ptr += get_uleb128(&ptr, end);
-			if (ptr > end || retAddrReg >= ARRAY_SIZE(reg_info)
-			    || REG_INVALID(retAddrReg)
-			    || reg_info[retAddrReg].width != sizeof(unsigned long))
-				cie = NULL;
-		}
-	}
-	if (cie != NULL) {
-		state.cieStart = ptr;
-		ptr = state.cieEnd;
-		state.cieEnd = end;
+		state.version = ci->version;
+		state.codeAlign = ci->codeAlign;
+		state.dataAlign = ci->dataAlign;
+		state.cieStart = ci->cieStart;
+		state.cieEnd = ci->cieEnd;
+		retAddrReg = ci->retAddrReg;
+		ptr = entry->instructions;
 		end = (const u8 *)(fde + 1) + *fde;
 		/* skip augmentation */
 		if (((const char *)(cie + 2))[1] == 'z') {
@@ -719,6 +690,8 @@ void init_unwind_table(void)
 		if (!(kt->flags & NO_DWARF_UNWIND))
 			kt->flags |= DWARF_UNWIND;
 
+		index_unwind_tables();
+
 		return;
 	}
 
@@ -748,6 +721,8 @@ void init_unwind_table(void)
 		if (CRASHDEBUG(1))
 			fprintf(fp, "init_unwind_table: DWARF_UNWIND_MEMORY\n");
 
+		index_unwind_tables();
+
 		return;
 	}
 
@@ -796,6 +771,8 @@ void init_unwind_table(void)
 		if (CRASHDEBUG(1))
 			fprintf(fp, "init_unwind_table: DWARF_UNWIND_EH_FRAME\n");
 
+		index_unwind_tables();
+
 		return;
 	}
 }
@@ -897,7 +874,7 @@ static int populate_local_tables(ulong root, char *buf)
 	cnt = retrieve_list(table_list, cnt);
 	hq_close();
 
-	if (!(local_unwind_tables = malloc(sizeof(struct local_unwind_table) * cnt))) {
+	if (!(local_unwind_tables = calloc(cnt, sizeof(struct local_unwind_table)))) {
 		error(WARNING, "cannot malloc unwind_table space (%d tables)\n", cnt);
 		FREEBUF(table_list);
 		return 0;
@@ -968,6 +945,242 @@ static struct local_unwind_table *find_table(unsigned long pc)
 	return table;
 }
 
+/*
+ *  Build the FDE indexes of all unwind tables up front, so that
+ *  the first backtrace does not pay for it.
+ */
+static void index_unwind_tables(void)
+{
+	int i;
+	int is_ehframe = (!st->dwarf_debug_frame_size && st->dwarf_eh_frame_size);
+
+	if (default_unwind_table.address)
+		build_fde_index(&default_unwind_table, is_ehframe);
+
+	for (i = 0; i < unwind_tables_cnt; i++)
+		build_fde_index(&local_unwind_tables[i], is_ehframe);
+}
+
+static int compare_fde_index(const void *v1, const void *v2)
+{
+	const struct fde_index_entry *e1 = v1, *e2 = v2;
+
+	if (e1->startLoc != e2->startLoc)
+		return e1->startLoc < e2->startLoc ? -1 : 1;
+	if (e1->fde != e2->fde)
+		return e1->fde < e2->fde ? -1 : 1;
+	return 0;
+}
+
+/*
+ *  Decode the fields of a CIE that unwind() needs, applying
+ *  the same checks it used to make for every frame.
+ */
+static void decode_cie(struct cie_info *ci)
+{
+	const u32 *cie = ci->cie;
+	const u8 *ptr, *end;
+
+	ci->valid = FALSE;
+
+	ptr = (const u8 *)(cie + 2);
+	end = (const u8 *)(cie + 1) + *cie;
+	if ((ci->version = *ptr) != 1)
+		return;		/* unsupported version */
+	if (*++ptr) {
+		/* check if augmentation size is first (and thus present) */
+		if (*ptr == 'z') {
+			/* check for ignorable (or already handled)
+			 * nul-terminated augmentation string */
+			while (++ptr < end && *ptr)
+				if (strchr("LPR", *ptr) == NULL)
+					break;
+		}
+		if (ptr >= end || *ptr)
+			return;
+	}
+	++ptr;
+
+	/* get code aligment factor */
+	ci->codeAlign = get_uleb128(&ptr, end);
+	/* get data aligment factor */
+	ci->dataAlign = get_sleb128(&ptr, end);
+	if (ci->codeAlign == 0 || ci->dataAlign == 0 || ptr >= end)
+		return;
+
+	ci->retAddrReg = ci->version <= 1 ? *ptr++ : get_uleb128(&ptr, end);
+	/* skip augmentation */
+	if (((const char *)(cie + 2))[1] == 'z')
+		ptr += get_uleb128(&ptr, end);
+	if (ptr > end || ci->retAddrReg >= ARRAY_SIZE(reg_info)
+	    || REG_INVALID(ci->retAddrReg)
+	    || reg_info[ci->retAddrReg].width != sizeof(unsigned long))
+		return;
+
+	ci->cieStart = ptr;
+	ci->cieEnd = end;
+	ci->valid = TRUE;
+}
+
+/*
+ *  The FDEs of a compilation unit follow its CIE, so only the most
+ *  recently used CIE is checked before a new one is added.
+ */
+static int get_cie_info(struct local_unwind_table *table, const u32 *cie, signed ptrType, int *max)
+{
+	struct cie_info *ci;
+
+	if (table->cie_cnt && (table->cie_info[table->cie_cnt-1].cie == cie))
+		return table->cie_cnt-1;
+
+	if (table->cie_cnt == *max) {
+		*max = *max ? *max * 2 : 64;
+		if (!(ci = realloc(table->cie_info, *max * sizeof(struct cie_info))))
+			return -1;
+		table->cie_info = ci;
+	}
+
+	ci = &table->cie_info[table->cie_cnt];
+	BZERO(ci, sizeof(struct cie_info));
+	ci->cie = cie;
+	ci->ptrType = ptrType;
+	decode_cie(ci);
+
+	return table->cie_cnt++;
+}
+
+/*
+ *  Walk the CIE/FDE table once, keeping every FDE whose CIE passes
+ *  the checks that unwind() used to make on each lookup.
+ */
+static int build_fde_index(struct local_unwind_table *table, int is_ehframe)
+{
+	const u32 *fde, *cie;
+	const u8 *ptr;
+	unsigned long tableSize, startLoc, endLoc, maxEnd;
+	void *unwind_table;
+	signed ptrType;
+	struct fde_index_entry *entry;
+	int i, max_fde, max_cie;
+
+	if (table->indexed)
+		return (table->fde_index != NULL);
+
+	table->indexed = TRUE;
+	max_fde = max_cie = 0;
+	unwind_table = table->address;
+	tableSize = table->size;
+
+	for (fde = unwind_table; tableSize > sizeof(*fde)
+	     && tableSize - sizeof(*fde) >= *fde;
+	     tableSize -= sizeof(*fde) + *fde, fde += 1 + *fde / sizeof(*fde)) {
+		if (!*fde || (*fde & (sizeof(*fde) - 1)))
+			break;
+		if (is_ehframe && !fde[1])
+			continue;	/* this is a CIE */
+		else if (fde[1] == 0xffffffff)
+			continue;	/* this is a CIE */
+		if ((fde[1] & (sizeof(*fde) - 1))
+		    || fde[1] > (unsigned long)(fde + 1)
+		    - (unsigned long)unwind_table)
+			continue;	/* this is not a valid FDE */
+		if (is_ehframe)
+			cie = fde + 1 - fde[1] / sizeof(*fde);
+		else
+			cie = unwind_table + fde[1];
+		if (*cie <= sizeof(*cie) + 4 || *cie >= fde[1] - sizeof(*fde)
+		    || (*cie & (sizeof(*cie) - 1))
+		    || (cie[1] != 0xffffffff && cie[1])
+		    || (ptrType = fde_pointer_type(cie)) < 0)
+			continue;	/* this is not a (valid) CIE */
+		ptr = (const u8 *)(fde + 2);
+		startLoc = read_pointer(&ptr, (const u8 *)(fde + 1) + *fde, ptrType);
+		endLoc =
+		    startLoc + read_pointer(&ptr,
+					    (const u8 *)(fde + 1) +
+					    *fde,
+					    ptrType & DW_EH_PE_indirect
+					    ? ptrType : ptrType & (DW_EH_PE_FORM | DW_EH_PE_signed));
+		if (startLoc >= endLoc)
+			continue;	/* can never match a pc */
+
+		if (table->fde_cnt == max_fde) {
+			max_fde = max_fde ? max_fde * 2 : 1024;
+			if (!(entry = realloc(table->fde_index, max_fde * sizeof(struct fde_index_entry))))
+				goto nomem;
+			table->fde_index = entry;
+		}
+
+		entry = &table->fde_index[table->fde_cnt];
+		entry->startLoc = startLoc;
+		entry->endLoc = endLoc;
+		entry->fde = fde;
+		entry->instructions = ptr;
+		if ((entry->cie = get_cie_info(table, cie, ptrType, &max_cie)) < 0)
+			goto nomem;
+		table->fde_cnt++;
+	}
+
+	if (!table->fde_cnt) {
+		free(table->cie_info);
+		table->cie_info = NULL;
+		table->cie_cnt = 0;
+		return FALSE;
+	}
+
+	qsort(table->fde_index, table->fde_cnt, sizeof(struct fde_index_entry), compare_fde_index);
+
+	for (i = 0, maxEnd = 0; i < table->fde_cnt; i++) {
+		maxEnd = max(maxEnd, table->fde_index[i].endLoc);
+		table->fde_index[i].maxEnd = maxEnd;
+	}
+
+	if (CRASHDEBUG(1))
+		fprintf(fp, "unwind table %lx: %d FDEs, %d CIEs indexed\n",
+			(ulong)table->address, table->fde_cnt, table->cie_cnt);
+
+	return TRUE;
+
+ nomem:
+	error(WARNING, "cannot malloc unwind table index space\n");
+	free(table->fde_index);
+	free(table->cie_info);
+	table->fde_index = NULL;
+	table->cie_info = NULL;
+	table->fde_cnt = table->cie_cnt = 0;
+	return FALSE;
+}
+
+/*
+ *  Find the FDE covering a pc.  Where FDEs overlap, the one that comes
+ *  first in the table wins, as it did with the linear search.
+ */
+static struct fde_index_entry *lookup_fde(struct local_unwind_table *table, unsigned long pc)
+{
+	struct fde_index_entry *index, *found;
+	int lo, hi, mid, i;
+
+	index = table->fde_index;
+	lo = 0;
+	hi = table->fde_cnt;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (index[mid].startLoc <= pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	found = NULL;
+	for (i = lo - 1; (i >= 0) && (index[i].maxEnd > pc); i--) {
+		if ((pc < index[i].endLoc) && (!found || (index[i].fde < found->fde)))
+			found = &index[i];
+	}
+
+	return found;
+}
+
 static void dump_local_unwind_tables(void)
 {
 	int i, others;
@@ -989,7 +1202,9 @@ static void dump_local_unwind_tables(void)
 
 	fprintf(fp, "default_unwind_table:\n");
 	fprintf(fp, "      address: %lx\n", (ulong) default_unwind_table.address);
-	fprintf(fp, "         size: %ld\n\n", (ulong) default_unwind_table.size);
+	fprintf(fp, "         size: %ld\n", (ulong) default_unwind_table.size);
+	fprintf(fp, "         FDEs: %d\n", default_unwind_table.fde_cnt);
+	fprintf(fp, "         CIEs: %d\n\n", default_unwind_table.cie_cnt);
 
 	fprintf(fp, "local_unwind_tables[%d]:\n", unwind_tables_cnt);
 	for (i = 0; i < unwind_tables_cnt; i++, tp++) {
@@ -1001,6 +1216,8 @@ static void dump_local_unwind_tables(void)
 		fprintf(fp, "        range: %ld\n", tp->init.range);
 		fprintf(fp, "      address: %lx\n", (ulong) tp->address);
 		fprintf(fp, "         size: %ld\n", tp->size);
+		fprintf(fp, "         FDEs: %d\n", tp->fde_cnt);
+		fprintf(fp, "         CIEs: %d\n", tp->cie_cnt);
 	}
 }
 
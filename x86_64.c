@@ -1718,6 +1718,11 @@ static int x86_64_kvtop(struct task_context *tc, ulong kvaddr, physaddr_t * padd
 
 		if (!IS_VMALLOC_ADDR(kvaddr)) {
 			*paddr = x86_64_VTOP(kvaddr);
+			/*
+			 *  Unity-mapped: report up to the next 2MB boundary,
+			 *  so readmem() can read large ranges in one call.
+			 */
+			vt->vtop_extent = MEGABYTES(2) - (kvaddr & ~_2MB_PAGE_MASK);
 			if (!verbose)
 				return TRUE;
 		}
@@ -1765,6 +1770,7 @@ static int x86_64_kvtop(struct task_context *tc, ulong kvaddr, physaddr_t * padd
 
 		physpage = (PAGEBASE(pmd_pte) & PHYSICAL_PAGE_MASK) + (kvaddr & ~_2MB_PAGE_MASK);
 		*paddr = physpage;
+		vt->vtop_extent = MEGABYTES(2) - (kvaddr & ~_2MB_PAGE_MASK);
 		return TRUE;
 	}
 
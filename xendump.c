@@ -29,7 +29,9 @@ static int xc_core_read(void *, int, ulong, physaddr_t);
 static int xc_core_mfns(ulong, FILE *);
 
 static void poc_store(ulong, off_t);
-static off_t poc_get(ulong, int *);
+static off_t poc_get(ulong);
+static void xendump_cache_init(void);
+static char *xendump_read_page(off_t);
 
 static void xen_dump_vmconfig(FILE *);
 
@@ -135,13 +137,7 @@ static int xc_core_verify(char *file, char *buf)
 	if (!xd->page_size)
 		error(FATAL, "unknown page size: use -p <pagesize> command line option\n");
 
-	if (!(xd->page = (char *)malloc(xd->page_size)))
-		error(FATAL, "cannot malloc page space.");
-
-	if (!(xd->poc = (struct pfn_offset_cache *)calloc
-	      (PFN_TO_OFFSET_CACHE_ENTRIES, sizeof(struct pfn_offset_cache))))
-		error(FATAL, "cannot malloc pfn_offset_cache\n");
-	xd->last_pfn = ~(0UL);
+	xendump_cache_init();
 
 	if (CRASHDEBUG(1))
 		xendump_memory_dump(stderr);
@@ -156,40 +152,25 @@ static int xc_core_read(void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 {
 	ulong pfn, page_index;
 	off_t offset;
-	int redundant;
 
 	if (xd->flags & (XC_CORE_P2M_CREATE | XC_CORE_PFN_CREATE))
 		xc_core_create_pfn_tables();
 
 	pfn = (ulong) BTOP(paddr);
 
-	if ((offset = poc_get(pfn, &redundant))) {
-		if (!redundant) {
-			if (lseek(xd->xfd, offset, SEEK_SET) == -1)
-				return SEEK_ERROR;
-			if (read(xd->xfd, xd->page, xd->page_size) != xd->page_size)
-				return READ_ERROR;
-			xd->last_pfn = pfn;
-		}
-
-		BCOPY(xd->page + PAGEOFFSET(paddr), bufptr, cnt);
-		return cnt;
-	}
-
-	if ((page_index = xc_core_pfn_to_page_index(pfn)) == PFN_NOT_FOUND)
-		return READ_ERROR;
+	if (!(offset = poc_get(pfn))) {
+		if ((page_index = xc_core_pfn_to_page_index(pfn)) == PFN_NOT_FOUND)
+			return READ_ERROR;
 
-	offset = (off_t) xd->xc_core.header.xch_pages_offset + ((off_t) (page_index) * (off_t) xd->page_size);
+		offset = (off_t) xd->xc_core.header.xch_pages_offset +
+		    ((off_t) (page_index) * (off_t) xd->page_size);
 
-	if (lseek(xd->xfd, offset, SEEK_SET) == -1)
-		return SEEK_ERROR;
+		poc_store(pfn, offset);
+	}
 
-	if (read(xd->xfd, xd->page, xd->page_size) != xd->page_size)
+	if (pread(xd->xfd, bufptr, cnt, offset + PAGEOFFSET(paddr)) != cnt)
 		return READ_ERROR;
-
-	poc_store(pfn, offset);
-
-	BCOPY(xd->page + PAGEOFFSET(paddr), bufptr, cnt);
+	xd->last_pfn = pfn;
 
 	return cnt;
 }
@@ -266,13 +247,7 @@ static int xc_save_verify(char *buf)
 	if (!xd->page_size)
 		error(FATAL, "unknown page size: use -p <pagesize> command line option\n");
 
-	if (!(xd->page = (char *)malloc(xd->page_size)))
-		error(FATAL, "cannot malloc page space.");
-
-	if (!(xd->poc = (struct pfn_offset_cache *)calloc
-	      (PFN_TO_OFFSET_CACHE_ENTRIES, sizeof(struct pfn_offset_cache))))
-		error(FATAL, "cannot malloc pfn_offset_cache\n");
-	xd->last_pfn = ~(0UL);
+	xendump_cache_init();
 
 	if (!(xd->xc_save.region_pfn_type = (ulong *) calloc(MAX_BATCH_SIZE, sizeof(ulong))))
 		error(FATAL, "cannot malloc region_pfn_type\n");
@@ -451,6 +426,8 @@ static int xc_save_verify(char *buf)
 	 */
 	free(xd->poc);
 	xd->poc = NULL;
+	free(xd->poc_hash);
+	xd->poc_hash = NULL;
 	free(xd->xc_save.region_pfn_type);
 	xd->xc_save.region_pfn_type = NULL;
 
@@ -553,10 +530,10 @@ static int xc_save_verify(char *buf)
  */
 static int xc_save_read(void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 {
-	int b, i, redundant;
+	int b, i;
 	ulong reqpfn;
 	int batch_count;
-	off_t file_offset;
+	off_t file_offset, page_offset;
 
 	reqpfn = (ulong) BTOP(paddr);
 
@@ -580,37 +557,19 @@ static int xc_save_read(void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 			return SEEK_ERROR;
 		}
 
-		if (reqpfn != xd->last_pfn) {
-			if (lseek(xd->xfd, file_offset, SEEK_SET) == -1)
-				return SEEK_ERROR;
-
-			if (read(xd->xfd, xd->page, xd->page_size) != xd->page_size)
-				return READ_ERROR;
-		} else {
+		if (reqpfn == xd->last_pfn)
 			xd->redundant++;
-			xd->cache_hits++;
-		}
-
 		xd->accesses++;
+
+		if (pread(xd->xfd, bufptr, cnt, file_offset + PAGEOFFSET(paddr)) != cnt)
+			return READ_ERROR;
 		xd->last_pfn = reqpfn;
 
-		BCOPY(xd->page + PAGEOFFSET(paddr), bufptr, cnt);
 		return cnt;
 	}
 
-	if ((file_offset = poc_get(reqpfn, &redundant))) {
-		if (!redundant) {
-			if (lseek(xd->xfd, file_offset, SEEK_SET) == -1)
-				return SEEK_ERROR;
-			if (read(xd->xfd, xd->page, xd->page_size) != xd->page_size)
-				return READ_ERROR;
-			xd->last_pfn = reqpfn;
-		} else if (CRASHDEBUG(1))
-			console("READ %ld (0x%lx) skipped!\n", reqpfn, reqpfn);
-
-		BCOPY(xd->page + PAGEOFFSET(paddr), bufptr, cnt);
-		return cnt;
-	}
+	if ((file_offset = poc_get(reqpfn)))
+		goto found;
 
 	/*
 	 *  ...
@@ -621,17 +580,24 @@ static int xc_save_read(void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 	 *  ...
 	 *  page batch_count-1
 	 *  (repeat)
+	 *
+	 *  The offsets of the pages in the batches that are passed over
+	 *  are cached along the way, but only while the cache has free
+	 *  entries, so that a scan never evicts the working set.  Since the
+	 *  batches are always scanned from the beginning, poc_store() does
+	 *  not replace an existing entry, and an entry is only evicted once
+	 *  the cache is full, after which nothing more is cached in passing,
+	 *  a cached offset is always that of the first copy of a pfn in the
+	 *  dumpfile, just as if it had been searched for.
 	 */
 	for (b = 0; b < xd->xc_save.batch_count; b++) {
 
-		if (lseek(xd->xfd, xd->xc_save.batch_offsets[b], SEEK_SET) == -1)
-			return SEEK_ERROR;
-
 		if (CRASHDEBUG(8))
 			fprintf(xd->ofp, "check batch[%d]: offset: %llx\n",
 				b, (ulonglong) xd->xc_save.batch_offsets[b]);
 
-		if (read(xd->xfd, &batch_count, sizeof(int)) != sizeof(int))
+		if (pread(xd->xfd, &batch_count, sizeof(int),
+		    xd->xc_save.batch_offsets[b]) != sizeof(int))
 			return READ_ERROR;
 
 		switch (batch_count) {
@@ -645,6 +611,8 @@ static int xc_save_read(void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 			return READ_ERROR;
 
 		default:
+			if ((batch_count < 0) || (batch_count > MAX_BATCH_SIZE))
+				return READ_ERROR;
 			if (CRASHDEBUG(8))
 				fprintf(xd->ofp,
 					"batch[%d]: offset: %llx batch count: %d\n",
@@ -652,10 +620,14 @@ static int xc_save_read(void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 			break;
 		}
 
-		if (read
-		    (xd->xfd, xd->xc_save.region_pfn_type, batch_count * sizeof(ulong)) != batch_count * sizeof(ulong))
+		page_offset = xd->xc_save.batch_offsets[b] + sizeof(int);
+
+		if (pread(xd->xfd, xd->xc_save.region_pfn_type, batch_count * sizeof(ulong),
+		    page_offset) != batch_count * sizeof(ulong))
 			return READ_ERROR;
 
+		page_offset += batch_count * sizeof(ulong);
+
 		for (i = 0; i < batch_count; i++) {
 			unsigned long pagetype;
 			unsigned long pfn;
@@ -672,82 +644,146 @@ static int xc_save_read(void *bufptr, int cnt, ulong addr, physaddr_t paddr)
 					fprintf(stderr, "batch_count: %d pfn %ld out of range", batch_count, pfn);
 			}
 
-			if (pfn == reqpfn) {
-				file_offset = lseek(xd->xfd, 0, SEEK_CUR);
-				poc_store(pfn, file_offset);
+			if ((pfn == reqpfn) && !file_offset)
+				file_offset = page_offset;
+			else if (xd->poc_count < PFN_TO_OFFSET_CACHE_ENTRIES)
+				poc_store(pfn, page_offset);
 
-				if (read(xd->xfd, xd->page, xd->page_size) != xd->page_size)
-					return READ_ERROR;
-
-				BCOPY(xd->page + PAGEOFFSET(paddr), bufptr, cnt);
-				return cnt;
-			}
+			page_offset += xd->page_size;
+		}
 
-			if (lseek(xd->xfd, xd->page_size, SEEK_CUR) == -1)
-				return SEEK_ERROR;
+		if (file_offset) {
+			poc_store(reqpfn, file_offset);
+			goto found;
 		}
 	}
 
 	return READ_ERROR;
+
+ found:
+	if (pread(xd->xfd, bufptr, cnt, file_offset + PAGEOFFSET(paddr)) != cnt)
+		return READ_ERROR;
+	xd->last_pfn = reqpfn;
+
+	return cnt;
 }
 
 /*
- *  Stash a pfn's offset.  If they're all in use, put it in the
- *  least-used slot that's closest to the beginning of the array.
+ *  Allocate the pfn-to-offset cache and the page cache, shared by the
+ *  xc_core, xc_core ELF and xc_save formats.  The page cache only holds
+ *  the dumpfile's own tables; the physical pages that read_xendump() and
+ *  read_xendump_hyper() return are cached by the generic dump page cache
+ *  in memory.c.
  */
-static void poc_store(ulong pfn, off_t file_offset)
+static void xendump_cache_init(void)
 {
 	int i;
-	struct pfn_offset_cache *poc, *plow;
-	ulong curlow;
-
-	curlow = ~(0UL);
-	plow = NULL;
-	poc = xd->poc;
-
-	for (i = 0; i < PFN_TO_OFFSET_CACHE_ENTRIES; i++, poc++) {
-		if (poc->cnt == 0) {
-			poc->cnt = 1;
-			poc->pfn = pfn;
-			poc->file_offset = file_offset;
-			xd->last_pfn = pfn;
+	char *buf;
+
+	if (!(xd->page = (char *)malloc(xd->page_size)))
+		error(FATAL, "cannot malloc page space.");
+
+	if (!(xd->poc = (struct pfn_offset_cache *)calloc
+	      (PFN_TO_OFFSET_CACHE_ENTRIES, sizeof(struct pfn_offset_cache))) ||
+	    !(xd->poc_hash = (int *)malloc(PFN_TO_OFFSET_HASH_BUCKETS * sizeof(int))))
+		error(FATAL, "cannot malloc pfn_offset_cache\n");
+	for (i = 0; i < PFN_TO_OFFSET_CACHE_ENTRIES; i++)
+		xd->poc[i].hash_next = -1;
+	for (i = 0; i < PFN_TO_OFFSET_HASH_BUCKETS; i++)
+		xd->poc_hash[i] = -1;
+	xd->last_pfn = ~(0UL);
+
+	if (!(xd->page_cache = (struct xendump_page_cache *)calloc
+	      (XENDUMP_CACHED_PAGES, sizeof(struct xendump_page_cache))) ||
+	    !(xd->page_cache_hash = (int *)malloc(XENDUMP_PAGE_HASH_BUCKETS * sizeof(int))) ||
+	    !(buf = (char *)malloc((size_t)XENDUMP_CACHED_PAGES * xd->page_size)))
+		error(FATAL, "cannot malloc xendump page cache\n");
+	for (i = 0; i < XENDUMP_CACHED_PAGES; i++) {
+		xd->page_cache[i].file_offset = -1;
+		xd->page_cache[i].bufptr = buf + ((size_t)i * xd->page_size);
+		xd->page_cache[i].hash_next = -1;
+	}
+	for (i = 0; i < XENDUMP_PAGE_HASH_BUCKETS; i++)
+		xd->page_cache_hash[i] = -1;
+}
+
+#define POC_HASH(pfn)  ((pfn) & (PFN_TO_OFFSET_HASH_BUCKETS-1))
+#define PAGE_CACHE_HASH(offset) \
+	((ulong)((offset) / xd->page_size) & (XENDUMP_PAGE_HASH_BUCKETS-1))
+
+/*
+ *  Stash a pfn's offset, unless it's already cached.  If the cache is
+ *  full, the slot is chosen with the CLOCK algorithm, skipping entries
+ *  that have been used since the hand last passed them.
+ */
+static void poc_store(ulong pfn, off_t file_offset)
+{
+	int i, *linkp;
+	struct pfn_offset_cache *poc;
+
+	if (!xd->poc)
+		return;
+
+	for (i = xd->poc_hash[POC_HASH(pfn)]; i >= 0; i = poc->hash_next) {
+		poc = &xd->poc[i];
+		if (poc->pfn == pfn)
 			return;
+	}
+
+	for (;;) {
+		i = xd->poc_evict_index;
+		xd->poc_evict_index = (i + 1) % PFN_TO_OFFSET_CACHE_ENTRIES;
+		poc = &xd->poc[i];
+
+		if (!poc->cnt) {
+			xd->poc_count++;
+			break;
+		}
+		if (poc->referenced) {
+			poc->referenced = FALSE;
+			continue;
 		}
 
-		if (poc->cnt < curlow) {
-			curlow = poc->cnt;
-			plow = poc;
+		for (linkp = &xd->poc_hash[POC_HASH(poc->pfn)]; *linkp >= 0;
+		     linkp = &xd->poc[*linkp].hash_next) {
+			if (*linkp == i) {
+				*linkp = poc->hash_next;
+				break;
+			}
 		}
+		xd->poc_evictions++;
+		break;
 	}
 
-	plow->cnt = 1;
-	plow->pfn = pfn;
-	plow->file_offset = file_offset;
-	xd->last_pfn = pfn;
+	poc->cnt = 1;
+	poc->pfn = pfn;
+	poc->file_offset = file_offset;
+	poc->referenced = FALSE;
+	poc->hash_next = xd->poc_hash[POC_HASH(pfn)];
+	xd->poc_hash[POC_HASH(pfn)] = i;
 }
 
 /*
- *  Check whether a pfn's offset has been cached.
+ *  Return a pfn's cached offset, or 0 if it has not been cached.
  */
-static off_t poc_get(ulong pfn, int *redundant)
+static off_t poc_get(ulong pfn)
 {
 	int i;
 	struct pfn_offset_cache *poc;
 
 	xd->accesses++;
 
-	if (pfn == xd->last_pfn) {
+	if (pfn == xd->last_pfn)
 		xd->redundant++;
-		*redundant = TRUE;
-		return 1;
-	} else
-		*redundant = FALSE;
 
-	poc = xd->poc;
+	if (!xd->poc)
+		return 0;
 
-	for (i = 0; i < PFN_TO_OFFSET_CACHE_ENTRIES; i++, poc++) {
-		if (poc->cnt && (poc->pfn == pfn)) {
+	for (i = xd->poc_hash[POC_HASH(pfn)]; i >= 0; i = poc->hash_next) {
+		poc = &xd->poc[i];
+		if (poc->pfn == pfn) {
 			poc->cnt++;
+			poc->referenced = TRUE;
 			xd->cache_hits++;
 			return poc->file_offset;
 		}
@@ -756,6 +792,62 @@ static off_t poc_get(ulong pfn, int *redundant)
 	return 0;
 }
 
+/*
+ *  Return a pointer to the cached copy of the dumpfile table page at
+ *  file_offset, reading it in if necessary, or NULL on failure.
+ */
+static char *xendump_read_page(off_t file_offset)
+{
+	int i, *linkp;
+	struct xendump_page_cache *pgc;
+
+	xd->page_accesses++;
+
+	for (i = xd->page_cache_hash[PAGE_CACHE_HASH(file_offset)]; i >= 0; i = pgc->hash_next) {
+		pgc = &xd->page_cache[i];
+		if (pgc->file_offset == file_offset) {
+			pgc->referenced = TRUE;
+			xd->page_hits++;
+			return pgc->bufptr;
+		}
+	}
+
+	for (;;) {
+		i = xd->page_evict_index;
+		xd->page_evict_index = (i + 1) % XENDUMP_CACHED_PAGES;
+		pgc = &xd->page_cache[i];
+
+		if (pgc->file_offset == -1)
+			break;
+		if (pgc->referenced) {
+			pgc->referenced = FALSE;
+			continue;
+		}
+
+		for (linkp = &xd->page_cache_hash[PAGE_CACHE_HASH(pgc->file_offset)];
+		     *linkp >= 0; linkp = &xd->page_cache[*linkp].hash_next) {
+			if (*linkp == i) {
+				*linkp = pgc->hash_next;
+				break;
+			}
+		}
+		pgc->file_offset = -1;
+		pgc->hash_next = -1;
+		xd->page_evictions++;
+		break;
+	}
+
+	if (pread(xd->xfd, pgc->bufptr, xd->page_size, file_offset) != xd->page_size)
+		return NULL;
+
+	pgc->file_offset = file_offset;
+	pgc->referenced = TRUE;
+	pgc->hash_next = xd->page_cache_hash[PAGE_CACHE_HASH(file_offset)];
+	xd->page_cache_hash[PAGE_CACHE_HASH(file_offset)] = i;
+
+	return pgc->bufptr;
+}
+
 /*
  *  Perform any post-dumpfile determination stuff here.
  */
@@ -799,14 +891,9 @@ int read_xendump_hyper(int fd, void *bufptr, int cnt, ulong addr, physaddr_t pad
 
 	offset = (off_t) xd->xc_core.header.xch_pages_offset + ((off_t) (page_index) * (off_t) xd->page_size);
 
-	if (lseek(xd->xfd, offset, SEEK_SET) == -1)
-		return SEEK_ERROR;
-
-	if (read(xd->xfd, xd->page, xd->page_size) != xd->page_size)
+	if (pread(xd->xfd, bufptr, cnt, offset + PAGEOFFSET(paddr)) != cnt)
 		return READ_ERROR;
 
-	BCOPY(xd->page + PAGEOFFSET(paddr), bufptr, cnt);
-
 	return cnt;
 }
 
@@ -912,6 +999,16 @@ int xendump_memory_dump(FILE * fp)
 	}
 	if (!xd->poc)
 		fprintf(fp, "\n");
+	fprintf(fp, "poc_evictions: %ld\n", xd->poc_evictions);
+	fprintf(fp, "   page_cache: %lx (%d pages)\n", (ulong) xd->page_cache,
+		XENDUMP_CACHED_PAGES);
+	fprintf(fp, "page_accesses: %ld\n", xd->page_accesses);
+	fprintf(fp, "    page_hits: %ld ", xd->page_hits);
+	if (xd->page_accesses)
+		fprintf(fp, "(%ld%%)\n", xd->page_hits * 100 / xd->page_accesses);
+	else
+		fprintf(fp, "\n");
+	fprintf(fp, "page_evictions: %ld\n", xd->page_evictions);
 
 	fprintf(fp, "\n      xc_save:\n");
 	fprintf(fp, "                  nr_pfns: %ld (0x%lx)\n", xd->xc_save.nr_pfns, xd->xc_save.nr_pfns);
@@ -1174,6 +1271,7 @@ char *xc_core_mfn_to_page(ulong mfn, char *pgbuf)
 	int i, b, idx, done;
 	ulong tmp[MAX_BATCH_SIZE];
 	off_t offset;
+	char *page;
 	size_t size;
 	uint nr_pages;
 
@@ -1215,22 +1313,14 @@ char *xc_core_mfn_to_page(ulong mfn, char *pgbuf)
 		return NULL;
 	}
 
-	if (lseek(xd->xfd, (off_t) xd->xc_core.header.xch_pages_offset, SEEK_SET) == -1) {
-		error(INFO, "cannot lseek to xch_pages_offset\n");
-		return NULL;
-	}
-
-	offset = (off_t) (idx) * (off_t) xd->page_size;
+	offset = (off_t) xd->xc_core.header.xch_pages_offset +
+	    (off_t) (idx) * (off_t) xd->page_size;
 
-	if (lseek(xd->xfd, offset, SEEK_CUR) == -1) {
-		error(INFO, "cannot lseek to mfn-specified page\n");
-		return NULL;
-	}
-
-	if (read(xd->xfd, pgbuf, xd->page_size) != xd->page_size) {
+	if (!(page = xendump_read_page(offset))) {
 		error(INFO, "cannot read mfn-specified page\n");
 		return NULL;
 	}
+	BCOPY(page, pgbuf, xd->page_size);
 
 	return pgbuf;
 }
@@ -1243,6 +1333,7 @@ static char *xc_core_elf_mfn_to_page(ulong mfn, char *pgbuf)
 {
 	int i, b, idx, done;
 	off_t offset;
+	char *page;
 	size_t size;
 	uint nr_pages;
 	ulong tmp;
@@ -1283,20 +1374,14 @@ static char *xc_core_elf_mfn_to_page(ulong mfn, char *pgbuf)
 		return NULL;
 	}
 
-	if (lseek(xd->xfd, (off_t) xd->xc_core.header.xch_pages_offset, SEEK_SET) == -1)
-		error(FATAL, "cannot lseek to xch_pages_offset\n");
-
-	offset = (off_t) (idx) * (off_t) xd->page_size;
-
-	if (lseek(xd->xfd, offset, SEEK_CUR) == -1) {
-		error(INFO, "cannot lseek to mfn-specified page\n");
-		return NULL;
-	}
+	offset = (off_t) xd->xc_core.header.xch_pages_offset +
+	    (off_t) (idx) * (off_t) xd->page_size;
 
-	if (read(xd->xfd, pgbuf, xd->page_size) != xd->page_size) {
+	if (!(page = xendump_read_page(offset))) {
 		error(INFO, "cannot read mfn-specified page\n");
 		return NULL;
 	}
+	BCOPY(page, pgbuf, xd->page_size);
 
 	return pgbuf;
 }
@@ -1541,24 +1626,14 @@ static ulong xc_core_pfn_to_page_index(ulong pfn)
 
 	p2m_idx = xd->xc_core.p2m_frame_index_list[idx];
 
-	if (lseek(xd->xfd, (off_t) xd->xc_core.header.xch_pages_offset, SEEK_SET) == -1) {
-		error(INFO, "cannot lseek to xch_pages_offset\n");
-		return PFN_NOT_FOUND;
-	}
+	offset = (off_t) xd->xc_core.header.xch_pages_offset +
+	    (off_t) (p2m_idx) * (off_t) xd->page_size;
 
-	offset = (off_t) (p2m_idx) * (off_t) xd->page_size;
-
-	if (lseek(xd->xfd, offset, SEEK_CUR) == -1) {
-		error(INFO, "cannot lseek to pfn-specified page\n");
-		return PFN_NOT_FOUND;
-	}
-
-	if (read(xd->xfd, xd->page, xd->page_size) != xd->page_size) {
+	if (!(up = (ulong *) xendump_read_page(offset))) {
 		error(INFO, "cannot read pfn-specified page\n");
 		return PFN_NOT_FOUND;
 	}
 
-	up = (ulong *) xd->page;
 	up += (pfn % PFNS_PER_PAGE);
 
 	mfn = *up;
@@ -1942,13 +2017,7 @@ static int xc_core_elf_verify(char *file, char *buf)
 	if (!xd->page_size)
 		error(FATAL, "unknown page size: use -p <pagesize> command line option\n");
 
-	if (!(xd->page = (char *)malloc(xd->page_size)))
-		error(FATAL, "cannot malloc page space.");
-
-	if (!(xd->poc = (struct pfn_offset_cache *)calloc
-	      (PFN_TO_OFFSET_CACHE_ENTRIES, sizeof(struct pfn_offset_cache))))
-		error(FATAL, "cannot malloc pfn_offset_cache\n");
-	xd->last_pfn = ~(0UL);
+	xendump_cache_init();
 
 	for (i = 0; i < INDEX_PFN_COUNT; i++)
 		xd->xc_core.elf_index_pfn[i].pfn = ~0UL;
@@ -50,9 +50,21 @@ struct xen_core_header {
 struct pfn_offset_cache {
 	off_t file_offset;
 	ulong pfn;
-	ulong cnt;
+	ulong cnt;		/* hits, or 0 if unused */
+	int hash_next;		/* next entry in hash chain, or -1 */
+	int referenced;
 };
-#define PFN_TO_OFFSET_CACHE_ENTRIES  (5000)
+#define PFN_TO_OFFSET_CACHE_ENTRIES  (65536)
+#define PFN_TO_OFFSET_HASH_BUCKETS   (65536)	/* power of 2 */
+
+struct xendump_page_cache {
+	off_t file_offset;	/* -1 if unused */
+	char *bufptr;
+	int hash_next;		/* next entry in hash chain, or -1 */
+	int referenced;
+};
+#define XENDUMP_CACHED_PAGES         (512)
+#define XENDUMP_PAGE_HASH_BUCKETS    (512)	/* power of 2 */
 
 struct elf_index_pfn {
 	ulong index;
@@ -80,6 +92,16 @@ struct xendump_data {
 	ulong redundant;
 	ulong last_pfn;
 	struct pfn_offset_cache *poc;
+	int *poc_hash;
+	int poc_evict_index;
+	int poc_count;
+	ulong poc_evictions;
+	struct xendump_page_cache *page_cache;
+	int *page_cache_hash;
+	int page_evict_index;
+	ulong page_accesses;
+	ulong page_hits;
+	ulong page_evictions;
 
 	struct xc_core_data {
 		int p2m_frames;